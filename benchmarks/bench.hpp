@@ -0,0 +1,126 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string_view>
+#include <type_traits>
+
+namespace bench {
+
+/**!
+ * Workload parameters shared by every suite
+ */
+struct config {
+	std::uint32_t elements = 50000;
+	std::uint32_t repeats  = 3;
+	std::uint32_t seed     = 0x5eed;
+};
+
+/**!
+ * 16 byte payload, index doubles as the backref member
+ */
+struct small_payload {
+	std::uint32_t index = 0;
+	std::uint32_t value = 0;
+	std::uint64_t pad   = 0;
+};
+static_assert(sizeof(small_payload) == 16);
+
+/**!
+ * 256 byte payload, same footprint as the SObject used in the unit tests
+ */
+struct large_payload {
+	std::uint32_t index = 0;
+	std::uint32_t value = 0;
+	char data[248]      = {};
+};
+static_assert(sizeof(large_payload) == 256);
+
+template <typename Ty> constexpr std::string_view payload_name() {
+	if constexpr (std::is_same_v<Ty, small_payload>)
+		return "16B";
+	else
+		return "256B";
+}
+
+template <typename Ty> inline auto& payload_of(Ty& iItem) {
+	if constexpr (std::is_pointer_v<std::remove_cv_t<Ty>>)
+		return *iItem;
+	else
+		return iItem;
+}
+
+inline volatile std::uint64_t sink = 0;
+
+/**!
+ * Result line, printed as one CSV record
+ */
+struct result {
+	std::string_view suite;
+	std::string_view table;
+	std::string_view payload;
+	std::string_view workload;
+	std::uint32_t occupancy  = 100;
+	std::uint32_t elements   = 0;
+	std::uint64_t operations = 0;
+	std::uint64_t total_ns   = 0;
+};
+
+inline void print_header() {
+	std::printf("suite,table,payload,workload,occupancy,elements,operations,"
+	            "total_ns,ns_per_op\n");
+}
+
+inline void print(result const& iResult) {
+	double per_op = iResult.operations
+	                    ? static_cast<double>(iResult.total_ns) /
+	                          static_cast<double>(iResult.operations)
+	                    : 0.0;
+	std::printf("%.*s,%.*s,%.*s,%.*s,%u,%u,%llu,%llu,%.3f\n",
+	            static_cast<int>(iResult.suite.size()), iResult.suite.data(),
+	            static_cast<int>(iResult.table.size()), iResult.table.data(),
+	            static_cast<int>(iResult.payload.size()), iResult.payload.data(),
+	            static_cast<int>(iResult.workload.size()),
+	            iResult.workload.data(), iResult.occupancy, iResult.elements,
+	            static_cast<unsigned long long>(iResult.operations),
+	            static_cast<unsigned long long>(iResult.total_ns), per_op);
+	std::fflush(stdout);
+}
+
+/**!
+ * Time a callable, returns nanoseconds
+ */
+template <typename Lambda> inline std::uint64_t measure(Lambda&& iLambda) {
+	auto start = std::chrono::steady_clock::now();
+	std::forward<Lambda>(iLambda)();
+	auto stop = std::chrono::steady_clock::now();
+	return static_cast<std::uint64_t>(
+	    std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start)
+	        .count());
+}
+
+/**!
+ * Best of config::repeats runs, Setup is rerun before every timed run and its
+ * return value is handed to Run
+ */
+template <typename Setup, typename Run>
+inline std::uint64_t best_of(config const& iConfig, Setup&& iSetup,
+                             Run&& iRun) {
+	std::uint64_t best = ~std::uint64_t(0);
+	for (std::uint32_t r = 0; r < std::max<std::uint32_t>(iConfig.repeats, 1);
+	     ++r) {
+		auto state = iSetup();
+		best       = std::min(best, measure([&]() { iRun(*state); }));
+	}
+	return best;
+}
+
+// suites
+void run_tables(config const& iConfig);
+void run_iterators(config const& iConfig);
+void run_parallel(config const& iConfig);
+void run_views(config const& iConfig);
+
+} // namespace bench
@@ -0,0 +1,70 @@
+#include "bench.hpp"
+#include <cpptables.hpp>
+#include <memory>
+#include <vector>
+
+namespace bench {
+namespace {
+
+/**!
+ * Forward and reverse iteration over a half erased table, repeated at growing
+ * sizes: a constant ns_per_op across sizes shows a step costs O(1) amortized
+ */
+template <typename Table>
+void run_suite(config const& iConfig, std::string_view iName) {
+	result r;
+	r.suite     = "iterators";
+	r.table     = iName;
+	r.payload   = payload_name<small_payload>();
+	r.occupancy = 50;
+
+	for (std::uint32_t n = std::max<std::uint32_t>(iConfig.elements >> 3, 64);
+	     n <= iConfig.elements; n <<= 1) {
+		auto sparse = [&]() {
+			auto t = std::make_unique<Table>();
+			std::vector<typename Table::link> links;
+			for (std::uint32_t i = 0; i < n; ++i) {
+				small_payload p;
+				p.value = i;
+				links.push_back(t->insert(p));
+			}
+			std::shuffle(links.begin(), links.end(), std::mt19937(iConfig.seed));
+			links.resize(n / 2);
+			std::sort(links.begin(), links.end(),
+			          [](auto a, auto b) { return a > b; });
+			for (auto l : links)
+				t->erase(l);
+			return t;
+		};
+		r.elements   = n;
+		r.operations = n - n / 2;
+
+		r.workload = "forward";
+		r.total_ns = best_of(iConfig, sparse, [&](Table& t) {
+			std::uint64_t sum = 0;
+			for (auto it = t.begin(), end = t.end(); it != end; ++it)
+				sum += it->value;
+			sink = sum;
+		});
+		print(r);
+
+		r.workload = "reverse";
+		r.total_ns = best_of(iConfig, sparse, [&](Table& t) {
+			std::uint64_t sum = 0;
+			for (auto it = t.rbegin(), end = t.rend(); it != end; ++it)
+				sum += it->value;
+			sink = sum;
+		});
+		print(r);
+	}
+}
+
+} // namespace
+
+void run_iterators(config const& iConfig) {
+	using namespace cpptables;
+	run_suite<tbl_sparse_sfree<small_payload>>(iConfig, "tbl_sparse_sfree");
+	run_suite<tbl_sparse_vmap<small_payload>>(iConfig, "tbl_sparse_vmap");
+}
+
+} // namespace bench
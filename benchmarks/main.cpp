@@ -0,0 +1,48 @@
+#include "bench.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+namespace {
+
+void usage(char const* iExe) {
+	std::fprintf(stderr,
+	             "usage: %s [--elements N] [--repeats N] [--seed N] "
+	             "[--suite name]\n"
+	             "  suites: tables, iterators, parallel, views, all (default)\n"
+	             "  output: CSV on stdout, one record per measurement\n",
+	             iExe);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	bench::config cfg;
+	std::string_view suite = "all";
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (i + 1 < argc && arg == "--elements")
+			cfg.elements = static_cast<std::uint32_t>(std::atol(argv[++i]));
+		else if (i + 1 < argc && arg == "--repeats")
+			cfg.repeats = static_cast<std::uint32_t>(std::atol(argv[++i]));
+		else if (i + 1 < argc && arg == "--seed")
+			cfg.seed = static_cast<std::uint32_t>(std::atol(argv[++i]));
+		else if (i + 1 < argc && arg == "--suite")
+			suite = argv[++i];
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	bench::print_header();
+	if (suite == "all" || suite == "tables")
+		bench::run_tables(cfg);
+	if (suite == "all" || suite == "iterators")
+		bench::run_iterators(cfg);
+	if (suite == "all" || suite == "parallel")
+		bench::run_parallel(cfg);
+	if (suite == "all" || suite == "views")
+		bench::run_views(cfg);
+	return 0;
+}
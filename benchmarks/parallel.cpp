@@ -0,0 +1,104 @@
+#include "bench.hpp"
+#include <cpptables.hpp>
+#include <memory>
+#include <vector>
+
+namespace bench {
+namespace {
+
+/**!
+ * A set of half erased tables whose sizes span elements >> 7 to elements,
+ * the shape of a simulation step touching many component tables
+ */
+template <typename Table> struct table_set {
+	table_set(config const& iConfig, std::uint32_t iTables) {
+		std::mt19937 rng(iConfig.seed);
+		for (std::uint32_t t = 0; t < iTables; ++t) {
+			std::uint32_t n = std::max<std::uint32_t>(iConfig.elements >> (t & 7), 64);
+			auto table      = std::make_unique<Table>();
+			std::vector<typename Table::link> links;
+			for (std::uint32_t i = 0; i < n; ++i) {
+				small_payload p;
+				p.value = i;
+				links.push_back(table->insert(p));
+			}
+			std::shuffle(links.begin(), links.end(), rng);
+			links.resize(n / 2);
+			std::sort(links.begin(), links.end(),
+			          [](auto a, auto b) { return a > b; });
+			for (auto l : links)
+				table->erase(l);
+			live += n - n / 2;
+			tables.push_back(std::move(table));
+		}
+	}
+
+	std::vector<std::unique_ptr<Table>> tables;
+	std::uint64_t live = 0;
+};
+
+inline void touch(small_payload& ioItem) {
+	ioItem.value = ioItem.value * 2654435761u + 1;
+}
+
+template <typename Table>
+void run_suite(config const& iConfig, std::string_view iName) {
+	constexpr std::uint32_t k_tables = 32;
+	using set_t                      = table_set<Table>;
+	auto setup = [&]() { return std::make_unique<set_t>(iConfig, k_tables); };
+
+	result r;
+	r.suite     = "parallel";
+	r.table     = iName;
+	r.payload   = payload_name<small_payload>();
+	r.occupancy = 50;
+	r.elements  = iConfig.elements;
+	r.operations = setup()->live;
+
+	r.workload = "sequential";
+	r.total_ns = best_of(iConfig, setup, [](set_t& s) {
+		for (auto& t : s.tables)
+			t->for_each(touch);
+	});
+	print(r);
+
+	auto& pool = cpptables::default_thread_pool();
+	r.workload = "parallel_for_each";
+	r.total_ns = best_of(iConfig, setup, [&pool](set_t& s) {
+		for (auto& t : s.tables)
+			t->parallel_for_each(pool, touch);
+	});
+	print(r);
+
+	cpptables::work_stealing_scheduler sched;
+	r.workload = "work_stealing";
+	r.total_ns = best_of(iConfig, setup, [&](set_t& s) {
+		for (auto& t : s.tables)
+			sched.add(*t, touch);
+		sched.run(pool);
+	});
+	print(r);
+
+	// utilization of the last run goes to stderr to keep stdout plain CSV
+	auto stats = sched.stats();
+	for (std::size_t w = 0; w < stats.size(); ++w)
+		std::fprintf(stderr,
+		             "# %.*s worker %zu: tasks %llu steals %llu "
+		             "utilization %.2f\n",
+		             static_cast<int>(iName.size()), iName.data(), w,
+		             static_cast<unsigned long long>(stats[w].tasks),
+		             static_cast<unsigned long long>(stats[w].steals),
+		             stats[w].utilization());
+}
+
+} // namespace
+
+void run_parallel(config const& iConfig) {
+	using namespace cpptables;
+	run_suite<tbl_sparse_vmap<small_payload>>(iConfig, "tbl_sparse_vmap");
+	run_suite<tbl_sparse_sfree<small_payload>>(iConfig, "tbl_sparse_sfree");
+	run_suite<tbl_sparse_br<small_payload, &small_payload::index>>(
+	    iConfig, "tbl_sparse_br");
+}
+
+} // namespace bench
@@ -0,0 +1,237 @@
+#include "bench.hpp"
+#include <cpptables.hpp>
+#include <memory>
+#include <vector>
+
+namespace bench {
+namespace {
+
+/**!
+ * A table plus the links it handed out, pointer tables also own a pool that
+ * backs the stored pointers
+ */
+template <typename Table> struct fixture {
+	using value_type = typename Table::value_type;
+	using link       = typename Table::link;
+	using payload    = std::remove_pointer_t<value_type>;
+	static constexpr bool is_p = std::is_pointer_v<value_type>;
+
+	explicit fixture(std::uint32_t iElements) {
+		links.reserve(iElements);
+		if constexpr (is_p)
+			pool.resize(iElements);
+	}
+
+	static auto key(link iLink) {
+		if constexpr (is_p)
+			return typename Table::ulink(iLink.value());
+		else
+			return iLink;
+	}
+
+	link add(std::uint32_t iValue) {
+		if constexpr (is_p) {
+			payload* p = &pool[next++];
+			p->value   = iValue;
+			return table.insert(p);
+		} else {
+			value_type v;
+			v.value = iValue;
+			return table.insert(v);
+		}
+	}
+
+	void fill(std::uint32_t iElements) {
+		for (std::uint32_t i = 0; i < iElements; ++i)
+			links.push_back(add(i));
+	}
+
+	payload& get(link iLink) { return table.at(key(iLink)); }
+
+	void erase(link iLink) { table.erase(key(iLink)); }
+
+	/**! Replace an object with a fresh one, pointer tables reuse the pointer */
+	link reinsert(link iLink, std::uint32_t iValue) {
+		if constexpr (is_p) {
+			payload* p = &get(iLink);
+			erase(iLink);
+			p->value = iValue;
+			return table.insert(p);
+		} else {
+			erase(iLink);
+			return add(iValue);
+		}
+	}
+
+	Table table;
+	std::vector<payload> pool;
+	std::vector<link> links;
+	std::uint32_t next = 0;
+};
+
+template <typename Table>
+constexpr bool has_iteration_v =
+    (static_cast<unsigned>(Table::tags) & cpptables::tags::no_iter::value) ==
+    0;
+
+template <typename Table>
+constexpr bool has_runs_v =
+    requires(Table& t) { t.for_each_run([](auto) {}); };
+
+template <typename Table>
+constexpr bool has_compact_v = requires(Table& t) { t.compact(); };
+
+template <typename Table>
+void run_suite(config const& iConfig, std::string_view iName) {
+	using fixture_t = fixture<Table>;
+	using payload   = typename fixture_t::payload;
+	const std::uint32_t n = iConfig.elements;
+
+	auto empty = [&]() { return std::make_unique<fixture_t>(n); };
+	auto full  = [&]() {
+		auto f = std::make_unique<fixture_t>(n);
+		f->fill(n);
+		return f;
+	};
+	auto shuffled = [&]() {
+		auto f = full();
+		std::shuffle(f->links.begin(), f->links.end(),
+		             std::mt19937(iConfig.seed));
+		return f;
+	};
+
+	result r;
+	r.suite    = "tables";
+	r.table    = iName;
+	r.payload  = payload_name<payload>();
+	r.elements = n;
+
+	// steady insert
+	r.workload   = "insert";
+	r.operations = n;
+	r.total_ns   = best_of(iConfig, empty, [&](fixture_t& f) { f.fill(n); });
+	print(r);
+
+	// random erase/reinsert churn
+	r.workload   = "churn";
+	r.operations = n;
+	r.total_ns   = best_of(iConfig, full, [&](fixture_t& f) {
+		std::mt19937 rng(iConfig.seed);
+		for (std::uint32_t i = 0; i < n; ++i) {
+			auto& l = f.links[rng() % n];
+			l       = f.reinsert(l, i);
+		}
+	});
+	print(r);
+
+	// mass erase in random order
+	r.workload   = "erase";
+	r.operations = n;
+	r.total_ns   = best_of(iConfig, shuffled, [&](fixture_t& f) {
+		for (auto l : f.links)
+			f.erase(l);
+	});
+	print(r);
+
+	// at(link) in random order
+	r.workload   = "lookup";
+	r.operations = n;
+	r.total_ns   = best_of(iConfig, shuffled, [&](fixture_t& f) {
+		std::uint64_t sum = 0;
+		for (auto l : f.links)
+			sum += f.get(l).value;
+		sink = sum;
+	});
+	print(r);
+
+	// for_each at partial occupancy
+	if constexpr (has_iteration_v<Table>) {
+		r.workload = "for_each";
+		for (std::uint32_t occupancy : {10u, 50u, 90u}) {
+			std::uint32_t live = static_cast<std::uint32_t>(
+			    (static_cast<std::uint64_t>(n) * occupancy) / 100);
+			auto sparse = [&]() {
+				auto f = shuffled();
+				// erase in descending slot order, setup cost is not measured
+				std::sort(f->links.begin() + live, f->links.end(),
+				          [](auto a, auto b) { return a > b; });
+				for (std::uint32_t i = live; i < n; ++i)
+					f->erase(f->links[i]);
+				f->links.resize(live);
+				return f;
+			};
+			r.occupancy  = occupancy;
+			r.operations = live;
+			r.total_ns   = best_of(iConfig, sparse, [&](fixture_t& f) {
+				std::uint64_t sum = 0;
+				f.table.for_each(
+				    [&sum](auto& item) { sum += payload_of(item).value; });
+				sink = sum;
+			});
+			print(r);
+
+			if constexpr (has_runs_v<Table>) {
+				r.workload = "for_each_run";
+				r.total_ns = best_of(iConfig, sparse, [&](fixture_t& f) {
+					std::uint64_t sum = 0;
+					f.table.for_each_run([&sum](auto run) {
+						for (auto& item : run)
+							sum += payload_of(item).value;
+					});
+					sink = sum;
+				});
+				print(r);
+				r.workload = "for_each";
+			}
+		}
+		r.occupancy = 100;
+	}
+
+	// compact a half erased table
+	if constexpr (has_compact_v<Table>) {
+		auto half = [&]() {
+			auto f = shuffled();
+			for (std::uint32_t i = n / 2; i < n; ++i)
+				f->erase(f->links[i]);
+			return f;
+		};
+		r.workload   = "compact";
+		r.occupancy  = 50;
+		r.operations = n - n / 2;
+		r.total_ns   = best_of(iConfig, half, [](fixture_t& f) {
+			sink = f.table.compact().size();
+		});
+		print(r);
+		r.occupancy = 100;
+	}
+}
+
+template <typename Ty> void run_payload(config const& iConfig) {
+	using namespace cpptables;
+	run_suite<tbl_packed<Ty>>(iConfig, "tbl_packed");
+	run_suite<tbl_packed_br<Ty, &Ty::index>>(iConfig, "tbl_packed_br");
+	run_suite<tbl_sparse_br<Ty, &Ty::index>>(iConfig, "tbl_sparse_br");
+	run_suite<tbl_sparse_vmap<Ty>>(iConfig, "tbl_sparse_vmap");
+	run_suite<tbl_sparse_vmap_br<Ty, &Ty::index>>(iConfig, "tbl_sparse_vmap_br");
+	run_suite<tbl_sparse_vmap_sum<Ty>>(iConfig, "tbl_sparse_vmap_sum");
+	run_suite<tbl_sparse_sfree<Ty>>(iConfig, "tbl_sparse_sfree");
+	run_suite<tbl_sparse_sfree_br<Ty, &Ty::index>>(iConfig,
+	                                               "tbl_sparse_sfree_br");
+	run_suite<tbl_sparse_no_iter<Ty>>(iConfig, "tbl_sparse_no_iter");
+	run_suite<tbl_sparse_no_iter_br<Ty, &Ty::index>>(iConfig,
+	                                                 "tbl_sparse_no_iter_br");
+	run_suite<tbl_sparse_vmap_pg<Ty>>(iConfig, "tbl_sparse_vmap_pg");
+	run_suite<tbl_sparse_sfree_pg<Ty>>(iConfig, "tbl_sparse_sfree_pg");
+	run_suite<tbl_sparse_no_iter_pg<Ty>>(iConfig, "tbl_sparse_no_iter_pg");
+	run_suite<tbl_sparse_ptr<Ty>>(iConfig, "tbl_sparse_ptr");
+	run_suite<tbl_sparse_ptr_br<Ty, &Ty::index>>(iConfig, "tbl_sparse_ptr_br");
+}
+
+} // namespace
+
+void run_tables(config const& iConfig) {
+	run_payload<small_payload>(iConfig);
+	run_payload<large_payload>(iConfig);
+}
+
+} // namespace bench
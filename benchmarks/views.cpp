@@ -0,0 +1,99 @@
+#include "bench.hpp"
+#include <cpptables.hpp>
+#include <memory>
+#include <vector>
+
+namespace bench {
+namespace {
+
+/**!
+ * A full table and a view holding a random half of it in random order, the
+ * usual shape of a view built from gameplay events
+ */
+template <typename Table> struct view_set {
+	view_set(config const& iConfig, bool iSorted) : view(table) {
+		std::vector<typename Table::link> links;
+		for (std::uint32_t i = 0; i < iConfig.elements; ++i) {
+			typename Table::value_type p;
+			p.value = i;
+			links.push_back(table.insert(p));
+		}
+		std::shuffle(links.begin(), links.end(), std::mt19937(iConfig.seed));
+		links.resize(iConfig.elements / 2);
+		for (auto l : links)
+			view.insert(l);
+		if (iSorted)
+			view.sort_by_location();
+	}
+
+	Table table;
+	cpptables::basic_view<Table> view;
+};
+
+/**!
+ * View traversal in list order without prefetch, in list order with
+ * prefetch and in table order (sorted once in setup, not timed)
+ */
+template <typename Table>
+void run_suite(config const& iConfig, std::string_view iName) {
+	using set_t = view_set<Table>;
+	auto list   = [&]() { return std::make_unique<set_t>(iConfig, false); };
+	auto sorted = [&]() { return std::make_unique<set_t>(iConfig, true); };
+	auto sum    = [](std::uint64_t& ioSum) {
+		   return [&ioSum](auto const& iItem) { ioSum += iItem.value; };
+	};
+
+	result r;
+	r.suite      = "views";
+	r.table      = iName;
+	r.payload    = payload_name<typename Table::value_type>();
+	r.occupancy  = 50;
+	r.elements   = iConfig.elements;
+	r.operations = iConfig.elements / 2;
+
+	r.workload = "unsorted";
+	r.total_ns = best_of(iConfig, list, [&](set_t& s) {
+		std::uint64_t total = 0;
+		s.view.template for_each<0>(sum(total));
+		sink = total;
+	});
+	print(r);
+
+	r.workload = "prefetched";
+	r.total_ns = best_of(iConfig, list, [&](set_t& s) {
+		std::uint64_t total = 0;
+		s.view.for_each(sum(total));
+		sink = total;
+	});
+	print(r);
+
+	r.workload = "sorted";
+	r.total_ns = best_of(iConfig, sorted, [&](set_t& s) {
+		std::uint64_t total = 0;
+		s.view.template for_each<0>(sum(total));
+		sink = total;
+	});
+	print(r);
+
+	r.workload = "sorted_prefetched";
+	r.total_ns = best_of(iConfig, sorted, [&](set_t& s) {
+		std::uint64_t total = 0;
+		s.view.for_each(sum(total));
+		sink = total;
+	});
+	print(r);
+}
+
+} // namespace
+
+void run_views(config const& iConfig) {
+	using namespace cpptables;
+	run_suite<tbl_packed<small_payload>>(iConfig, "tbl_packed");
+	run_suite<tbl_packed<large_payload>>(iConfig, "tbl_packed");
+	run_suite<tbl_sparse_sfree<small_payload>>(iConfig, "tbl_sparse_sfree");
+	run_suite<tbl_sparse_sfree<large_payload>>(iConfig, "tbl_sparse_sfree");
+	run_suite<tbl_sparse_vmap<small_payload>>(iConfig, "tbl_sparse_vmap");
+	run_suite<tbl_sparse_vmap<large_payload>>(iConfig, "tbl_sparse_vmap");
+}
+
+} // namespace bench
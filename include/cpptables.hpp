@@ -1,9 +1,17 @@
 #pragma once
 #include "details/basic_types.hpp"
 // containers
+#include "details/growth_policy.hpp"
 #include "details/podvector.hpp"
 #include "details/table_types.hpp"
+// parallel iteration
+#include "details/thread_pool.hpp"
+#include "details/work_stealing.hpp"
+// deferred mutation
+#include "details/command_buffer.hpp"
 
 // views
 #include <details/basic_view.hpp>
+#include <details/bitset_view.hpp>
+#include <details/compressed_view.hpp>
 #include <details/sorted_view.hpp>
@@ -63,6 +63,27 @@ struct validmap {
 struct sortedfree {
 	enum { value = 64 };
 };
+struct summary {
+	enum { value = 128 };
+};
+struct paged {
+	enum { value = 256 };
+};
+struct soa {
+	enum { value = 512 };
+};
+struct hot_cold {
+	enum { value = 1024 };
+};
+struct generational {
+	enum { value = 2048 };
+};
+struct concurrent {
+	enum { value = 4096 };
+};
+struct epoch {
+	enum { value = 8192 };
+};
 
 } // namespace tags
 
@@ -98,6 +119,23 @@ template <auto Member> struct with_backref : std::true_type {
 	}
 };
 
+/**!
+ * Generation policy. with_generations keeps a generation per slot in release
+ * builds too: links carry it above the slot index like the debug spoilers,
+ * and the table checks it with the same load that finds the object. Slot
+ * indices are then limited to constants::k_index_mask.
+ */
+struct no_generations : std::false_type {};
+struct with_generations : std::true_type {};
+
+/**!
+ * Reclamation policy of the concurrent table. with_epochs keeps erased
+ * objects alive, and their slots off the free list, until no reader pinned
+ * in the table's epoch_domain can still reach them.
+ */
+struct no_reclamation : std::false_type {};
+struct with_epochs : std::true_type {};
+
 namespace details {
 
 template <typename U, typename V>
@@ -107,16 +145,39 @@ template <typename T>
 constexpr bool has_backref_v =
     !std::is_same_v<no_backref, T> && !std::is_same_v<std::false_type, T>;
 
+/**!
+ * Slots of type Block can be handed out as a Ty array: Block is a standard
+ * layout wrapper with the size and alignment of Ty, so the Ty of each slot
+ * sits at the slot's address and slot i + 1 starts sizeof(Ty) bytes later,
+ * as in a Ty[]. for_each_run relies on this to span runs of slots. Only a
+ * real array makes such pointer steps defined by the standard, the tables
+ * rely on them behaving like one for these layouts, as compilers do.
+ */
+template <typename Block, typename Ty>
+constexpr bool is_array_layout_v = std::is_standard_layout_v<Block> &&
+                                   sizeof(Block) == sizeof(Ty) &&
+                                   alignof(Block) == alignof(Ty);
+
 template <typename SizeType> struct index_t {
 	using constants = details::constants<SizeType>;
 	index_t()       = default;
 	index_t(SizeType iID) : val_(iID) {}
 #ifdef CPPTABLES_DEBUG
+	/**!
+	 * Every table builds the links it hands out here, so this is where a
+	 * slot beyond the debug index width (4096 for 16 bit sizes) is caught
+	 * before its link aliases a lower slot
+	 */
 	index_t(SizeType iIndex, std::uint8_t iSpoiler)
-	    : val_(iIndex |
-	           (static_cast<SizeType>(iSpoiler) << constants::k_spoiler_shift)) {}
+	    : val_(static_cast<SizeType>(
+	          iIndex |
+	          (static_cast<SizeType>(iSpoiler) << constants::k_spoiler_shift))) {
+		assert(iIndex <= constants::k_index_mask &&
+		       "Table outgrew the slot index debug links can carry");
+	}
 	[[nodiscard]] std::uint8_t spoiler() const {
-		return static_cast<std::uint8_t>(val_ >> constants::k_spoiler_shift) & 0x7f;
+		return static_cast<std::uint8_t>(val_ >> constants::k_spoiler_shift) &
+		       constants::k_spoiler_max;
 	}
 	SizeType index() const { return val_ & constants::k_index_mask; }
 	SizeType value() const { return val_; }
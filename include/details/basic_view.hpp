@@ -1,85 +1,247 @@
 #pragma once
+#include "basic_types.hpp"
 #include "podvector.hpp"
+#include "prefetch.hpp"
+#include <algorithm>
 #include <functional>
+#include <span>
+#include <vector>
 
 namespace cpptables {
-template <typename Container> class basic_view {
+
+/**!
+ * Position policy of basic_view. with_positions keeps the position of every
+ * member in the list in a map indexed by link slot and sized to the table,
+ * making insert, erase, find and contains O(1). A slot is then a member at
+ * most once: inserting its link again does nothing, and a link to a new
+ * object in the slot replaces the stale member in place.
+ */
+struct no_positions : std::false_type {};
+struct with_positions : std::true_type {};
+
+namespace details {
+
+/**!
+ * Slot of the link value iItem in Container, spoiler and generation bits
+ * dropped
+ */
+template <typename Container>
+inline typename Container::size_type view_key(
+    typename Container::size_type iItem) noexcept {
+	using size_type = typename Container::size_type;
+	if constexpr (requires { Container::tags; }) {
+		if constexpr ((static_cast<unsigned>(Container::tags) &
+		               tags::generational::value) != 0)
+			return iItem & constants<size_type>::k_index_mask;
+	}
+	return index_t<size_type>(iItem).index();
+}
+
+/**!
+ * List position of every link slot of Container, k_null if the link is not
+ * a member. Spoiler and generation bits are dropped from the key.
+ */
+template <typename Container> class view_positions {
+public:
+	using size_type = typename Container::size_type;
+	using constants = details::constants<size_type>;
+
+	inline size_type get(size_type iItem) const noexcept {
+		size_type key = key_of(iItem);
+		return key < positions_.size() ? positions_[key] : constants::k_null;
+	}
+	inline void set(Container const& iCont, size_type iItem,
+	                size_type iPosition) {
+		size_type key = key_of(iItem);
+		if (key >= positions_.size())
+			positions_.resize(
+			    std::max<std::size_t>(std::size_t(key) + 1, iCont.range()),
+			    constants::k_null);
+		positions_[key] = iPosition;
+	}
+	inline void reset(size_type iItem) noexcept {
+		positions_[key_of(iItem)] = constants::k_null;
+	}
+	void rebuild(Container const& iCont, podvector<size_type> const& iItems) {
+		positions_.clear();
+		for (size_type i = 0, n = static_cast<size_type>(iItems.size()); i < n;
+		     ++i)
+			set(iCont, iItems[i], i);
+	}
+
+private:
+	static inline size_type key_of(size_type iItem) noexcept {
+		return view_key<Container>(iItem);
+	}
+
+	std::vector<size_type> positions_;
+};
+
+struct no_view_positions {};
+
+} // namespace details
+
+template <typename Container, typename Positions = no_positions>
+class basic_view {
 public:
 	using size_type    = typename Container::size_type;
 	using link         = typename Container::link;
 	using value_type = typename Container::value_type;
+	static constexpr bool k_positions = Positions::value;
 
 	basic_view(Container& iTy, podvector<size_type> const& iList)
-	    : container(iTy), items(iList) {}
+	    : items(iList), container(iTy) {
+		rebuild_positions();
+	}
 	basic_view(Container& iTy, podvector<size_type>&& iList)
-	    : container(iTy), items(std::move(iList)) {}
+	    : items(std::move(iList)), container(iTy) {
+		rebuild_positions();
+	}
 	basic_view(Container& iTy) : container(iTy) {}
 	basic_view(basic_view&& iOther)
-	    : container(std::move(iOther.container)), items(std::move(iOther.items)) {
-	}
+	    : items(std::move(iOther.items)), container(std::move(iOther.container)),
+	      positions(std::move(iOther.positions)) {}
 	basic_view(basic_view const& iOther)
-	    : container(iOther.container), items(iOther.items) {}
+	    : items(iOther.items), container(iOther.container),
+	      positions(iOther.positions) {}
 
 	inline basic_view& operator=(basic_view&& iOther) {
 		container = iOther.container;
 		items     = std::move(iOther.items);
+		positions = std::move(iOther.positions);
 		return *this;
 	}
 
 	inline basic_view& operator=(basic_view const& iOther) {
 		container = iOther.container;
 		items     = iOther.items;
+		positions = iOther.positions;
 		return *this;
 	}
 	inline size_type size() const { return static_cast<size_type>(items.size()); }
-	template <typename Lambda> inline void for_each(Lambda&& iLambda) const {
-		size_type end = size();
-		for (size_type i = 0; i < end; ++i) {
-			std::forward<Lambda>(iLambda)(container.get().at(items[i]));
-		}
+	/**! Link values of the members, in list order */
+	inline std::span<size_type const> list() const noexcept {
+		return std::span<size_type const>(items.data(), items.size());
 	}
-	template <typename Lambda>
+	/**!
+	 * Lambda called for each object in list order. Objects are prefetched
+	 * Distance items ahead, list order is usually random in the table, see
+	 * sort_by_location.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	inline void for_each(Lambda&& iLambda) const {
+		for_each<Distance>(0, size(), std::forward<Lambda>(iLambda));
+	}
+	/**! Lambda called for each object in [iFirst, iLast) of the list */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
 	inline void for_each(size_type iFirst, size_type iLast,
 	                     Lambda&& iLambda) const {
-		for (; iFirst < iLast; ++iFirst) {
-			std::forward<Lambda>(iLambda)(container.get()[items[iFirst]]);
-		}
+		if (iFirst >= iLast)
+			return;
+		Container& cont = container.get();
+		details::prefetched_walk<Distance>(
+		    std::span<size_type const>(items.data() + iFirst, iLast - iFirst),
+		    [&cont](size_type iItem) {
+			    details::prefetch(&cont.at(link(iItem)));
+		    },
+		    [&](size_type iItem) { iLambda(cont.at(link(iItem))); });
+	}
+	/**!
+	 * Reorder the list by where the objects live in the table so for_each
+	 * walks its storage forward. That is link order for sparse tables and
+	 * dense position for packed ones, which later erases in the table
+	 * shuffle again. Positions returned by find are invalidated.
+	 */
+	void sort_by_location() {
+		Container& cont = container.get();
+		std::vector<std::pair<void const*, size_type>> keyed;
+		keyed.reserve(items.size());
+		for (auto item : items)
+			keyed.emplace_back(&cont.at(link(item)), item);
+		std::sort(keyed.begin(), keyed.end(),
+		          [](auto const& iFirst, auto const& iSecond) {
+			          return std::less<void const*>()(iFirst.first,
+			                                          iSecond.first);
+		          });
+		for (size_type i = 0; i < size(); ++i)
+			items[i] = keyed[i].second;
+		rebuild_positions();
 	}
 	inline value_type& at(size_type iIndex) {
-		return container.get()[items[iIndex]];
+		return container.get().at(link(items[iIndex]));
 	}
 	inline const value_type& at(size_type iIndex) const {
-		return container.get()[items[iIndex]];
+		return container.get().at(link(items[iIndex]));
 	}
 	inline void insert(value_type const& iComp) {
 		insert(container.get().get_link(iComp));
 	}
-	inline void insert(link iCompIndex) { items.push_back(iCompIndex); }
+	inline void insert(link iCompIndex) { push_back(iCompIndex); }
 	inline void push_back(value_type const& iComp) {
-		items.push_back(container.get().get_link(iComp));
+		push_back(container.get().get_link(iComp));
+	}
+	inline void push_back(link iCompIndex) {
+		if constexpr (k_positions) {
+			size_type position = positions.get(iCompIndex.value());
+			if (position != details::constants<size_type>::k_null) {
+				items[position] = iCompIndex.value();
+				return;
+			}
+			positions.set(container.get(), iCompIndex.value(), size());
+		}
+		items.push_back(iCompIndex.value());
 	}
-	inline void push_back(link iCompIndex) { items.push_back(iCompIndex); }
-	inline void erase(value_type const& iComp) {
-		erase(container.get().get_link(iComp));
+	inline bool erase(value_type const& iComp) {
+		return erase(container.get().get_link(iComp));
 	}
-	inline void erase(link iCompIndex) {
-		items[find(iCompIndex)] = items.back();
+	/**! Remove iCompIndex, the last member takes its position */
+	inline bool erase(link iCompIndex) {
+		size_type position = find(iCompIndex);
+		if (position == details::constants<size_type>::k_null)
+			return false;
+		if constexpr (k_positions) {
+			positions.reset(items[position]);
+			if (position + 1 != size())
+				positions.set(container.get(), items.back(), position);
+		}
+		items[position] = items.back();
 		items.pop_back();
+		return true;
 	}
 	inline size_type find(value_type const& iComp) const {
 		return find(container.get().get_link(iComp));
 	}
+	/**! Position of iCompIndex in the list, k_null if it is not a member */
 	inline size_type find(link iCompIndex) const {
-		auto first = std::begin(items);
-		auto last  = std::end(items);
-		auto it    = std::find(first, last, (size_type)iCompIndex);
-		if (it != last)
-			return static_cast<size_type>(std::distance(first, it));
-		return details::constants<size_type>::k_null;
+		if constexpr (k_positions) {
+			size_type position = positions.get(iCompIndex.value());
+			if (position != details::constants<size_type>::k_null &&
+			    items[position] == iCompIndex.value())
+				return position;
+			return details::constants<size_type>::k_null;
+		} else {
+			auto first = std::begin(items);
+			auto last  = std::end(items);
+			auto it    = std::find(first, last, (size_type)iCompIndex);
+			if (it != last)
+				return static_cast<size_type>(std::distance(first, it));
+			return details::constants<size_type>::k_null;
+		}
+	}
+	inline bool contains(link iCompIndex) const {
+		return find(iCompIndex) != details::constants<size_type>::k_null;
 	}
 
 protected:
+	inline void rebuild_positions() {
+		if constexpr (k_positions)
+			positions.rebuild(container.get(), items);
+	}
+
 	podvector<size_type> items;
 	std::reference_wrapper<Container> container;
+	[[no_unique_address]] std::conditional_t<
+	    k_positions, details::view_positions<Container>,
+	    details::no_view_positions> positions;
 };
 } // namespace cpptables
@@ -0,0 +1,211 @@
+#pragma once
+#include "constants.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+
+namespace cpptables {
+namespace details {
+
+/**!
+ * Walkers over a free map, slot i is free when bit i & 63 of word i >> 6 is
+ * set and slots past the last word are live. Fully free words are skipped
+ * through a Skip: next(w) is the first word at or after w with a live slot,
+ * the word count if none, and prev(w) the last word before w with one,
+ * k_null if none. scan_words is the plain word by word Skip, a table with a
+ * summary of its live words passes its own.
+ */
+using bitmap_word = std::uint64_t;
+enum : std::uint32_t { k_bitmap_shift = 6, k_bitmap_mask = 63 };
+inline constexpr bitmap_word k_bitmap_all = ~bitmap_word(0);
+
+template <typename SizeType> struct scan_words {
+	std::span<bitmap_word const> bits;
+
+	SizeType next(SizeType iW) const {
+		SizeType words = static_cast<SizeType>(bits.size());
+		while (iW < words && bits[iW] == k_bitmap_all)
+			++iW;
+		return std::min(iW, words);
+	}
+	SizeType prev(SizeType iW) const {
+		while (iW > 0) {
+			if (bits[--iW] != k_bitmap_all)
+				return iW;
+		}
+		return constants<SizeType>::k_null;
+	}
+};
+
+/**! Free slots of iBits in [iBeg, iEnd) */
+template <typename SizeType>
+SizeType count_free(std::span<bitmap_word const> iBits, SizeType iBeg,
+                    SizeType iEnd) {
+	SizeType end = static_cast<SizeType>(
+	    std::min<std::size_t>(iEnd, iBits.size() << k_bitmap_shift));
+	SizeType free = 0;
+	if (iBeg >= end)
+		return free;
+	SizeType w     = iBeg >> k_bitmap_shift;
+	SizeType last  = (end - 1) >> k_bitmap_shift;
+	bitmap_word bits = iBits[w] & (k_bitmap_all << (iBeg & k_bitmap_mask));
+	for (;;) {
+		if (w == last)
+			bits &= k_bitmap_all >> (k_bitmap_mask - ((end - 1) & k_bitmap_mask));
+		free += static_cast<SizeType>(std::popcount(bits));
+		if (w == last)
+			break;
+		bits = iBits[++w];
+	}
+	return free;
+}
+
+/**! First free slot at or after iIdx, k_null if there is none */
+template <typename SizeType>
+SizeType next_free(std::span<bitmap_word const> iBits, SizeType iIdx) {
+	SizeType w     = iIdx >> k_bitmap_shift;
+	SizeType words = static_cast<SizeType>(iBits.size());
+	if (w >= words)
+		return constants<SizeType>::k_null;
+	bitmap_word bits = iBits[w] & (k_bitmap_all << (iIdx & k_bitmap_mask));
+	while (!bits) {
+		if (++w == words)
+			return constants<SizeType>::k_null;
+		bits = iBits[w];
+	}
+	return (w << k_bitmap_shift) +
+	       static_cast<SizeType>(std::countr_zero(bits));
+}
+
+/**! First live slot at or after iIdx */
+template <typename SizeType, typename Skip>
+SizeType next_live(std::span<bitmap_word const> iBits, SizeType iIdx,
+                   Skip const& iSkip) {
+	SizeType w     = iIdx >> k_bitmap_shift;
+	SizeType words = static_cast<SizeType>(iBits.size());
+	if (w >= words)
+		return iIdx;
+	bitmap_word live = ~iBits[w] & (k_bitmap_all << (iIdx & k_bitmap_mask));
+	if (!live) {
+		w = iSkip.next(w + 1);
+		if (w == words)
+			return w << k_bitmap_shift;
+		live = ~iBits[w];
+	}
+	return (w << k_bitmap_shift) +
+	       static_cast<SizeType>(std::countr_zero(live));
+}
+
+/**! Last live slot at or before iIdx, k_null if there is none */
+template <typename SizeType, typename Skip>
+SizeType prev_live(std::span<bitmap_word const> iBits, SizeType iIdx,
+                   Skip const& iSkip) {
+	SizeType w = iIdx >> k_bitmap_shift;
+	if (w >= iBits.size())
+		return iIdx;
+	bitmap_word live =
+	    ~iBits[w] & (k_bitmap_all >> (k_bitmap_mask - (iIdx & k_bitmap_mask)));
+	if (!live) {
+		w = iSkip.prev(w);
+		if (w == constants<SizeType>::k_null)
+			return w;
+		live = ~iBits[w];
+	}
+	return (w << k_bitmap_shift) + k_bitmap_mask -
+	       static_cast<SizeType>(std::countl_zero(live));
+}
+
+/**! iVisit called with each live slot in [iBegin, iEnd), in order */
+template <typename SizeType, typename Skip, typename Visit>
+void for_each_live(std::span<bitmap_word const> iBits, SizeType iBegin,
+                   SizeType iEnd, Skip const& iSkip, Visit&& iVisit) {
+	SizeType mapped = static_cast<SizeType>(
+	    std::min<std::size_t>(iEnd, iBits.size() << k_bitmap_shift));
+	if (iBegin < mapped) {
+		SizeType w       = iBegin >> k_bitmap_shift;
+		SizeType last    = (mapped - 1) >> k_bitmap_shift;
+		bitmap_word live = ~iBits[w] & (k_bitmap_all << (iBegin & k_bitmap_mask));
+		for (;;) {
+			if (w == last)
+				live &= k_bitmap_all >> (k_bitmap_mask - ((mapped - 1) & k_bitmap_mask));
+			while (live) {
+				iVisit((w << k_bitmap_shift) +
+				       static_cast<SizeType>(std::countr_zero(live)));
+				live &= live - 1;
+			}
+			if (w == last)
+				break;
+			w = iSkip.next(w + 1);
+			if (w > last)
+				break;
+			live = ~iBits[w];
+		}
+		iBegin = mapped;
+	}
+	for (; iBegin < iEnd; ++iBegin)
+		iVisit(iBegin);
+}
+
+/**!
+ * iEmit called with [first, last) of each maximal run of live slots in
+ * [iBegin, iEnd), in order
+ */
+template <typename SizeType, typename Skip, typename Emit>
+void for_each_live_run(std::span<bitmap_word const> iBits, SizeType iBegin,
+                       SizeType iEnd, Skip const& iSkip, Emit&& iEmit) {
+	constexpr SizeType k_null = constants<SizeType>::k_null;
+	if (iBegin >= iEnd)
+		return;
+	SizeType run    = k_null;
+	SizeType mapped = static_cast<SizeType>(
+	    std::min<std::size_t>(iEnd, iBits.size() << k_bitmap_shift));
+	if (iBegin < mapped) {
+		// a run starts where a live bit follows a free one and ends where a
+		// free bit follows a live one, carry links the words
+		SizeType w        = iBegin >> k_bitmap_shift;
+		SizeType last     = (mapped - 1) >> k_bitmap_shift;
+		bitmap_word live  = ~iBits[w] & (k_bitmap_all << (iBegin & k_bitmap_mask));
+		bitmap_word carry = 0;
+		for (;;) {
+			if (w == last)
+				live &= k_bitmap_all >> (k_bitmap_mask - ((mapped - 1) & k_bitmap_mask));
+			bitmap_word prev   = (live << 1) | carry;
+			bitmap_word starts = live & ~prev;
+			bitmap_word ends   = ~live & prev;
+			SizeType base      = w << k_bitmap_shift;
+			while (starts | ends) {
+				if (run == k_null) {
+					run = base + static_cast<SizeType>(std::countr_zero(starts));
+					starts &= starts - 1;
+				} else {
+					iEmit(run, base + static_cast<SizeType>(std::countr_zero(ends)));
+					ends &= ends - 1;
+					run = k_null;
+				}
+			}
+			carry = live >> k_bitmap_mask;
+			if (w == last)
+				break;
+			SizeType next = iSkip.next(w + 1);
+			if (next != w + 1 && run != k_null) {
+				// skipped words are fully free
+				iEmit(run, (w + 1) << k_bitmap_shift);
+				run   = k_null;
+				carry = 0;
+			}
+			if (next > last)
+				break;
+			w    = next;
+			live = ~iBits[w];
+		}
+		if (run != k_null && mapped == iEnd)
+			iEmit(run, mapped);
+	}
+	// slots past the map are all valid
+	if (mapped < iEnd)
+		iEmit(run == k_null ? std::max(mapped, iBegin) : run, iEnd);
+}
+
+} // namespace details
+} // namespace cpptables
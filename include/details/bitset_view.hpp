@@ -0,0 +1,172 @@
+#pragma once
+#include "basic_view.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cpptables {
+namespace details {
+
+/**!
+ * ioFirst[w] = iOp(ioFirst[w], iSecond[w]) for w < iCount. Blocks of four
+ * words are loaded before any store so the block vectorizes even without a
+ * runtime aliasing check.
+ */
+template <typename Op>
+inline void combine_words(std::uint64_t* ioFirst, std::uint64_t const* iSecond,
+                          std::size_t iCount, Op iOp) noexcept {
+	std::size_t w      = 0;
+	std::size_t blocks = iCount & ~std::size_t(3);
+	for (; w < blocks; w += 4) {
+		std::uint64_t a0 = ioFirst[w], a1 = ioFirst[w + 1], a2 = ioFirst[w + 2],
+		              a3 = ioFirst[w + 3];
+		std::uint64_t b0 = iSecond[w], b1 = iSecond[w + 1], b2 = iSecond[w + 2],
+		              b3 = iSecond[w + 3];
+		ioFirst[w]     = iOp(a0, b0);
+		ioFirst[w + 1] = iOp(a1, b1);
+		ioFirst[w + 2] = iOp(a2, b2);
+		ioFirst[w + 3] = iOp(a3, b3);
+	}
+	for (; w < iCount; ++w)
+		ioFirst[w] = iOp(ioFirst[w], iSecond[w]);
+}
+
+} // namespace details
+
+/**!
+ * View holding one bit per slot of a sparse table (any table with
+ * at_index), sized to its range(). Membership is a bit test and views of
+ * the same table combine with word wide AND/OR/ANDNOT loops the compiler
+ * vectorizes. Iteration is in slot order. Objects erased from the table
+ * must be erased from the view as well.
+ */
+template <typename Container> class bitset_view {
+public:
+	using size_type  = typename Container::size_type;
+	using link       = typename Container::link;
+	using value_type = typename Container::value_type;
+	using word       = std::uint64_t;
+
+	enum : std::uint32_t { k_word_shift = 6, k_word_mask = 63 };
+
+	bitset_view(Container& iTy) : container(iTy) {}
+
+	/**! Number of members, counted when a set operation changed the bits */
+	inline size_type size() const noexcept { return count_; }
+	inline bool empty() const noexcept { return count_ == 0; }
+
+	/**! Add iCompIndex, returns false if it was already a member */
+	inline bool insert(link iCompIndex) {
+		size_type key = details::view_key<Container>(iCompIndex.value());
+		std::size_t w = key >> k_word_shift;
+		if (w >= words_.size())
+			grow(w + 1);
+		word bit = word(1) << (key & k_word_mask);
+		if (words_[w] & bit)
+			return false;
+		words_[w] |= bit;
+		count_++;
+		return true;
+	}
+	/**! Remove iCompIndex, returns false if it was not a member */
+	inline bool erase(link iCompIndex) {
+		size_type key = details::view_key<Container>(iCompIndex.value());
+		std::size_t w = key >> k_word_shift;
+		word bit      = word(1) << (key & k_word_mask);
+		if (w >= words_.size() || !(words_[w] & bit))
+			return false;
+		words_[w] &= ~bit;
+		count_--;
+		return true;
+	}
+	inline bool contains(link iCompIndex) const noexcept {
+		size_type key = details::view_key<Container>(iCompIndex.value());
+		std::size_t w = key >> k_word_shift;
+		return w < words_.size() &&
+		       (words_[w] >> (key & k_word_mask) & word(1)) != 0;
+	}
+	inline void clear() noexcept {
+		words_.clear();
+		count_ = 0;
+	}
+
+	/**! Lambda called with the slot of each member, in slot order */
+	template <typename Lambda> void for_each_slot(Lambda&& iLambda) const {
+		for (std::size_t w = 0, n = words_.size(); w < n; ++w) {
+			for (word bits = words_[w]; bits; bits &= bits - 1)
+				iLambda(static_cast<size_type>((w << k_word_shift) +
+				                               std::countr_zero(bits)));
+		}
+	}
+	/**! Lambda called with each member object, in slot order */
+	template <typename Lambda> void for_each(Lambda&& iLambda) const {
+		Container& cont = container.get();
+		for_each_slot([&](size_type iSlot) { iLambda(cont.at_index(iSlot)); });
+	}
+
+	/**! Keep the members of iOther only, both must view the same table */
+	bitset_view& operator&=(bitset_view const& iOther) {
+		std::size_t n = std::min(words_.size(), iOther.words_.size());
+		words_.resize(n);
+		details::combine_words(words_.data(), iOther.words_.data(), n,
+		                       [](word a, word b) { return a & b; });
+		return recount();
+	}
+	/**! Add the members of iOther, both must view the same table */
+	bitset_view& operator|=(bitset_view const& iOther) {
+		if (words_.size() < iOther.words_.size())
+			words_.resize(iOther.words_.size(), 0);
+		details::combine_words(words_.data(), iOther.words_.data(),
+		                       iOther.words_.size(),
+		                       [](word a, word b) { return a | b; });
+		return recount();
+	}
+	/**! Drop the members of iOther, both must view the same table */
+	bitset_view& subtract(bitset_view const& iOther) {
+		std::size_t n = std::min(words_.size(), iOther.words_.size());
+		details::combine_words(words_.data(), iOther.words_.data(), n,
+		                       [](word a, word b) { return a & ~b; });
+		return recount();
+	}
+
+	friend bitset_view operator&(bitset_view iFirst, bitset_view const& iSecond) {
+		iFirst &= iSecond;
+		return iFirst;
+	}
+	friend bitset_view operator|(bitset_view iFirst, bitset_view const& iSecond) {
+		iFirst |= iSecond;
+		return iFirst;
+	}
+	/**! Members of iFirst not in iSecond */
+	friend bitset_view difference(bitset_view iFirst,
+	                              bitset_view const& iSecond) {
+		iFirst.subtract(iSecond);
+		return iFirst;
+	}
+
+	/**! The bitmap, bit i of word w is slot w * 64 + i */
+	std::span<word const> words() const noexcept { return words_; }
+
+private:
+	/**! At least iWords words, and enough for the table's range() */
+	void grow(std::size_t iWords) {
+		std::size_t range = container.get().range();
+		words_.resize(
+		    std::max(iWords, (range + k_word_mask) >> k_word_shift), 0);
+	}
+	bitset_view& recount() noexcept {
+		std::size_t count = 0;
+		for (word w : words_)
+			count += static_cast<std::size_t>(std::popcount(w));
+		count_ = static_cast<size_type>(count);
+		return *this;
+	}
+
+	std::vector<word> words_;
+	std::reference_wrapper<Container> container;
+	size_type count_ = 0;
+};
+
+} // namespace cpptables
@@ -0,0 +1,143 @@
+#pragma once
+#include "paged_storage.hpp"
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace cpptables {
+namespace details {
+
+/**!
+ * Cold part of the objects of a hot/cold split table, slot i of the cold
+ * array belongs to slot i of the hot storage. The table drives it in
+ * lockstep with its own storage: construct/destroy with the object, move in
+ * compaction and reserve/shrink/deallocate with the hot slots. PageShift 0
+ * keeps one contiguous array, otherwise it is paged like the hot storage.
+ */
+template <typename Cold, typename SizeType, typename Allocator,
+          unsigned PageShift>
+class cold_array {
+	struct block {
+		alignas(Cold) std::byte storage[sizeof(Cold)];
+	};
+	using block_allocator =
+	    typename std::allocator_traits<Allocator>::template rebind_alloc<block>;
+	using storage = std::conditional_t<PageShift != 0,
+	                                   page_directory<block, SizeType, PageShift>,
+	                                   block*>;
+
+public:
+	inline Cold& get(SizeType iIndex) noexcept {
+		return *std::launder(reinterpret_cast<Cold*>(items_[iIndex].storage));
+	}
+	inline Cold const& get(SizeType iIndex) const noexcept {
+		return *std::launder(
+		    reinterpret_cast<Cold const*>(items_[iIndex].storage));
+	}
+	template <typename... Args>
+	inline void construct(SizeType iIndex, Args&&... iArgs) {
+		::new (static_cast<void*>(items_[iIndex].storage))
+		    Cold(std::forward<Args>(iArgs)...);
+	}
+	inline void destroy(SizeType iIndex) noexcept {
+		if constexpr (!std::is_trivially_destructible_v<Cold>)
+			get(iIndex).~Cold();
+	}
+	inline void move(SizeType iFrom, SizeType iTo) {
+		construct(iTo, std::move(get(iFrom)));
+		destroy(iFrom);
+	}
+
+	/**!
+	 * Room for iCapacity slots, the live ones among the first iSize
+	 * (iLive(i) is true) are moved if the array is reallocated
+	 */
+	template <typename Live>
+	void reserve(Allocator const& iAllocator, SizeType iSize,
+	             SizeType iCapacity, Live&& iLive) {
+		block_allocator allocator(iAllocator);
+		if constexpr (PageShift != 0) {
+			items_.reserve(allocator, iCapacity);
+		} else {
+			block* d = allocator.allocate(iCapacity);
+			if (std::is_trivially_copyable_v<Cold>) {
+				if (iSize)
+					std::memcpy(static_cast<void*>(d), items_,
+					            std::min(iSize, iCapacity) * sizeof(block));
+			} else {
+				for (SizeType i = 0, n = std::min(iSize, iCapacity); i < n; ++i) {
+					if (iLive(i)) {
+						::new (static_cast<void*>(d[i].storage))
+						    Cold(std::move(get(i)));
+						destroy(i);
+					}
+				}
+			}
+			deallocate(iAllocator);
+			items_    = d;
+			capacity_ = iCapacity;
+		}
+	}
+	/**! Paged storage gives back the pages past iSize, see page_directory */
+	void shrink(Allocator const& iAllocator, SizeType iSize) {
+		if constexpr (PageShift != 0) {
+			block_allocator allocator(iAllocator);
+			items_.shrink(allocator, iSize);
+		}
+	}
+	void deallocate(Allocator const& iAllocator) {
+		block_allocator allocator(iAllocator);
+		if constexpr (PageShift != 0) {
+			items_.deallocate(allocator);
+		} else {
+			if (items_)
+				allocator.deallocate(items_, capacity_);
+			items_    = nullptr;
+			capacity_ = 0;
+		}
+	}
+
+private:
+	storage items_     = {};
+	SizeType capacity_ = 0;
+};
+
+/**! Tables without a cold part carry an empty cold_array */
+template <typename SizeType, typename Allocator, unsigned PageShift>
+class cold_array<void, SizeType, Allocator, PageShift> {
+public:
+	template <typename... Args> inline void construct(SizeType, Args&&...) {}
+	inline void destroy(SizeType) noexcept {}
+	inline void move(SizeType, SizeType) {}
+	template <typename Live>
+	void reserve(Allocator const&, SizeType, SizeType, Live&&) {}
+	void shrink(Allocator const&, SizeType) {}
+	void deallocate(Allocator const&) {}
+};
+
+struct no_cold_vector {
+	template <typename... Args> void emplace_back(Args&&...) {}
+	void pop_back() {}
+	void clear() {}
+};
+
+/**!
+ * Cold part of a packed table, a vector kept the same size as the dense
+ * items
+ */
+template <typename Cold, typename Allocator> struct cold_vector {
+	using type = std::vector<
+	    Cold, typename std::allocator_traits<Allocator>::template rebind_alloc<
+	              Cold>>;
+};
+template <typename Allocator> struct cold_vector<void, Allocator> {
+	using type = no_cold_vector;
+};
+
+template <typename Cold, typename Allocator>
+using cold_vector_t = typename cold_vector<Cold, Allocator>::type;
+
+} // namespace details
+} // namespace cpptables
@@ -0,0 +1,120 @@
+#pragma once
+#include "basic_types.hpp"
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <vector>
+
+namespace cpptables {
+
+/**!
+ * Inserts and erases recorded by one worker during a parallel phase and
+ * replayed on the table by apply() at the sync point, from one thread.
+ * Links for inserts are handed out at once from slots reserved up front,
+ * so objects recorded in the phase can already link to each other.
+ *
+ * Give each worker or task its own buffer and reserve() before the phase;
+ * the reservations take the table's free slots and grow it once. apply()
+ * fills the reserved slots, erases in one pass and returns unused slots to
+ * the free list together. Table needs reserve_links, emplace_at,
+ * release_links and erase_bulk (tbl_sparse_br).
+ */
+template <typename Table> class table_command_buffer {
+public:
+	using size_type  = typename Table::size_type;
+	using link       = typename Table::link;
+	using value_type = typename Table::value_type;
+
+	/**! Buffer for iTable, with iReserve provisional links reserved */
+	explicit table_command_buffer(Table& iTable, size_type iReserve = 0)
+	    : table_(iTable) {
+		reserve(iReserve);
+	}
+	table_command_buffer(table_command_buffer const&)            = delete;
+	table_command_buffer& operator=(table_command_buffer const&) = delete;
+	table_command_buffer(table_command_buffer&&) noexcept        = default;
+	table_command_buffer& operator=(table_command_buffer&&)      = delete;
+	/**! Pending commands are dropped, see discard */
+	~table_command_buffer() { discard(); }
+
+	/**! Reserve iCount more links, mutates the table: call between phases */
+	void reserve(size_type iCount) {
+		table_.get().reserve_links(iCount, std::back_inserter(reserved_));
+	}
+	/**! Inserts left before the reservation runs out */
+	size_type available() const noexcept {
+		return static_cast<size_type>(reserved_.size() - inserts_.size());
+	}
+	/**! Recorded inserts and erases */
+	size_type pending() const noexcept {
+		return static_cast<size_type>(inserts_.size() + erases_.size());
+	}
+
+	/**!
+	 * Record an insert, returns the link the object will have after apply.
+	 * Asserts and returns a null link once the reservation is used up.
+	 */
+	inline link insert(value_type const& iObject) { return emplace(iObject); }
+	/**! Record an object constructed from iArgs, see insert */
+	template <typename... Args> link emplace(Args&&... iArgs) {
+		if (inserts_.size() == reserved_.size()) {
+			assert(false && "Command buffer ran out of reserved links");
+			return link();
+		}
+		inserts_.emplace_back(std::forward<Args>(iArgs)...);
+		return reserved_[inserts_.size() - 1];
+	}
+	/**! Record an erase, iIndex may be a link handed out by any buffer */
+	inline void erase(link iIndex) { erases_.push_back(iIndex); }
+
+	/**!
+	 * Replay on the table, inserts before erases, and return the unused
+	 * reservations. Erasing a link inserted by another buffer needs that
+	 * buffer applied first, apply_all orders it across buffers.
+	 */
+	void apply() {
+		apply_inserts();
+		apply_erases();
+	}
+	/**! Apply the inserts of every buffer, then their erases */
+	static void apply_all(std::span<table_command_buffer> iBuffers) {
+		for (auto& buffer : iBuffers)
+			buffer.apply_inserts();
+		for (auto& buffer : iBuffers)
+			buffer.apply_erases();
+	}
+	/**!
+	 * Drop the pending commands and release every reservation, links handed
+	 * out by this buffer become invalid
+	 */
+	void discard() {
+		if (!reserved_.empty())
+			table_.get().release_links(reserved_);
+		reserved_.clear();
+		inserts_.clear();
+		erases_.clear();
+	}
+
+private:
+	void apply_inserts() {
+		Table& table = table_.get();
+		for (std::size_t i = 0, n = inserts_.size(); i < n; ++i)
+			table.emplace_at(reserved_[i], std::move(inserts_[i]));
+		table.release_links(std::span<link const>(reserved_).subspan(
+		    inserts_.size()));
+		reserved_.clear();
+		inserts_.clear();
+	}
+	void apply_erases() {
+		table_.get().erase_bulk(erases_);
+		erases_.clear();
+	}
+
+	std::reference_wrapper<Table> table_;
+	std::vector<link> reserved_;
+	std::vector<value_type> inserts_;
+	std::vector<link> erases_;
+};
+
+} // namespace cpptables
@@ -0,0 +1,414 @@
+#pragma once
+#include "bitset_view.hpp"
+#include "sorted_view.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace cpptables {
+namespace details {
+
+/**!
+ * Members of one 64K slot chunk of a compressed_view, stored the roaring
+ * way: a sorted array of the low 16 bits up to k_array_max members, a 64K
+ * bit bitmap above that, or sorted runs once optimize finds them smaller.
+ */
+struct compressed_chunk {
+	enum : std::uint32_t {
+		k_shift     = 16,
+		k_words     = 1024,
+		k_array_max = 4096
+	};
+	enum class kind : std::uint8_t { array, bitmap, run };
+	struct run {
+		std::uint16_t first;
+		std::uint16_t last;
+	};
+
+	std::size_t high    = 0;
+	std::uint32_t count = 0;
+	kind type           = kind::array;
+	std::vector<std::uint16_t> values;
+	std::vector<std::uint64_t> bits;
+	std::vector<run> runs;
+
+	bool contains(std::uint16_t iLow) const noexcept {
+		switch (type) {
+		case kind::array:
+			return std::binary_search(values.begin(), values.end(), iLow);
+		case kind::bitmap:
+			return (bits[iLow >> 6] >> (iLow & 63) & 1) != 0;
+		default: {
+			auto it = run_after(iLow);
+			return it != runs.begin() && (it - 1)->last >= iLow;
+		}
+		}
+	}
+	/**! Returns false if iLow was already a member */
+	bool insert(std::uint16_t iLow) {
+		if (type == kind::run) {
+			if (contains(iLow))
+				return false;
+			if (count + 1 > k_array_max)
+				to_bitmap();
+			else
+				to_array();
+		}
+		if (type == kind::array) {
+			auto it = std::lower_bound(values.begin(), values.end(), iLow);
+			if (it != values.end() && *it == iLow)
+				return false;
+			if (count < k_array_max) {
+				values.insert(it, iLow);
+				count++;
+				return true;
+			}
+			to_bitmap();
+		}
+		std::uint64_t bit = std::uint64_t(1) << (iLow & 63);
+		if (bits[iLow >> 6] & bit)
+			return false;
+		bits[iLow >> 6] |= bit;
+		count++;
+		return true;
+	}
+	/**! Returns false if iLow was not a member */
+	bool erase(std::uint16_t iLow) {
+		if (!contains(iLow))
+			return false;
+		if (type == kind::run) {
+			if (count - 1 > k_array_max)
+				to_bitmap();
+			else
+				to_array();
+		}
+		if (type == kind::array) {
+			values.erase(std::lower_bound(values.begin(), values.end(), iLow));
+			count--;
+			return true;
+		}
+		bits[iLow >> 6] &= ~(std::uint64_t(1) << (iLow & 63));
+		if (--count <= k_array_max)
+			to_array();
+		return true;
+	}
+	/**! Number of members below iLow */
+	std::uint32_t rank(std::uint16_t iLow) const noexcept {
+		switch (type) {
+		case kind::array:
+			return static_cast<std::uint32_t>(
+			    std::lower_bound(values.begin(), values.end(), iLow) -
+			    values.begin());
+		case kind::bitmap: {
+			std::uint32_t r = 0;
+			for (std::uint32_t w = 0, e = iLow >> 6; w < e; ++w)
+				r += static_cast<std::uint32_t>(std::popcount(bits[w]));
+			std::uint64_t below = (std::uint64_t(1) << (iLow & 63)) - 1;
+			return r + static_cast<std::uint32_t>(
+			               std::popcount(bits[iLow >> 6] & below));
+		}
+		default: {
+			std::uint32_t r = 0;
+			for (auto const& span : runs) {
+				if (span.first >= iLow)
+					break;
+				r += std::min<std::uint32_t>(span.last, iLow - 1) - span.first + 1;
+			}
+			return r;
+		}
+		}
+	}
+	/**! Lambda called with the low bits of each member, ascending */
+	template <typename Lambda> void for_each(Lambda&& iLambda) const {
+		switch (type) {
+		case kind::array:
+			for (auto low : values)
+				iLambda(low);
+			break;
+		case kind::bitmap:
+			for (std::uint32_t w = 0; w < k_words; ++w) {
+				for (std::uint64_t b = bits[w]; b; b &= b - 1)
+					iLambda(static_cast<std::uint16_t>((w << 6) +
+					                                   std::countr_zero(b)));
+			}
+			break;
+		default:
+			for (auto const& span : runs) {
+				for (std::uint32_t low = span.first; low <= span.last; ++low)
+					iLambda(static_cast<std::uint16_t>(low));
+			}
+		}
+	}
+
+	void to_bitmap() {
+		if (type == kind::bitmap)
+			return;
+		std::vector<std::uint64_t> b(k_words, 0);
+		for_each([&](std::uint16_t iLow) {
+			b[iLow >> 6] |= std::uint64_t(1) << (iLow & 63);
+		});
+		reset(kind::bitmap);
+		bits = std::move(b);
+	}
+	void to_array() {
+		if (type == kind::array)
+			return;
+		std::vector<std::uint16_t> v;
+		v.reserve(count);
+		for_each([&](std::uint16_t iLow) { v.push_back(iLow); });
+		reset(kind::array);
+		values = std::move(v);
+	}
+	void to_runs() {
+		if (type == kind::run)
+			return;
+		std::vector<run> r;
+		for_each([&](std::uint16_t iLow) {
+			if (!r.empty() && r.back().last + 1 == iLow)
+				r.back().last = iLow;
+			else
+				r.push_back({iLow, iLow});
+		});
+		reset(kind::run);
+		runs = std::move(r);
+	}
+	/**! Switch to the smallest of the three forms */
+	void optimize() {
+		std::size_t spans = 0;
+		std::int32_t prev = -2;
+		for_each([&](std::uint16_t iLow) {
+			spans += iLow != prev + 1;
+			prev = iLow;
+		});
+		std::size_t as_array  = count * sizeof(std::uint16_t);
+		std::size_t as_bitmap = k_words * sizeof(std::uint64_t);
+		std::size_t as_runs   = spans * sizeof(run);
+		if (as_runs < std::min(as_array, as_bitmap))
+			to_runs();
+		else if (as_array <= as_bitmap)
+			to_array();
+		else
+			to_bitmap();
+		values.shrink_to_fit();
+		runs.shrink_to_fit();
+	}
+	std::size_t bytes() const noexcept {
+		return values.capacity() * sizeof(std::uint16_t) +
+		       bits.capacity() * sizeof(std::uint64_t) +
+		       runs.capacity() * sizeof(run);
+	}
+
+	/**!
+	 * Members of both chunks. Arrays are filtered by membership tests,
+	 * other pairs are ANDed as bitmaps.
+	 */
+	static compressed_chunk intersect(compressed_chunk const& iFirst,
+	                                  compressed_chunk const& iSecond) {
+		compressed_chunk result;
+		result.high = iFirst.high;
+		if (iFirst.type == kind::array || iSecond.type == kind::array) {
+			auto const& list = iFirst.type == kind::array ? iFirst : iSecond;
+			auto const& other = iFirst.type == kind::array ? iSecond : iFirst;
+			for (auto low : list.values)
+				if (other.contains(low))
+					result.values.push_back(low);
+			result.count = static_cast<std::uint32_t>(result.values.size());
+			return result;
+		}
+		compressed_chunk second = iSecond;
+		second.to_bitmap();
+		result       = iFirst;
+		result.to_bitmap();
+		combine_words(result.bits.data(), second.bits.data(), k_words,
+		              [](std::uint64_t a, std::uint64_t b) { return a & b; });
+		result.count = 0;
+		for (auto w : result.bits)
+			result.count += static_cast<std::uint32_t>(std::popcount(w));
+		if (result.count <= k_array_max)
+			result.to_array();
+		return result;
+	}
+
+private:
+	std::vector<run>::const_iterator run_after(std::uint16_t iLow) const {
+		return std::upper_bound(runs.begin(), runs.end(), iLow,
+		                        [](std::uint16_t iValue, run const& iRun) {
+			                        return iValue < iRun.first;
+		                        });
+	}
+	void reset(kind iType) {
+		values.clear();
+		bits.clear();
+		bits.shrink_to_fit();
+		runs.clear();
+		type = iType;
+	}
+};
+
+} // namespace details
+
+/**!
+ * Membership view for large, clustered sets of slots. Slots are split in
+ * chunks of 64K and every chunk holds its members as an array, a bitmap or
+ * runs, see details::compressed_chunk. Works with the same slot addressed
+ * tables as bitset_view and iterates in slot order.
+ */
+template <typename Container> class compressed_view {
+public:
+	using size_type  = typename Container::size_type;
+	using link       = typename Container::link;
+	using value_type = typename Container::value_type;
+	using chunk      = details::compressed_chunk;
+
+	compressed_view(Container& iTy) : container(iTy) {}
+
+	inline size_type size() const noexcept { return count_; }
+	inline bool empty() const noexcept { return count_ == 0; }
+
+	/**! Add iCompIndex, returns false if it was already a member */
+	bool insert(link iCompIndex) {
+		std::size_t key = details::view_key<Container>(iCompIndex.value());
+		auto it         = chunk_at(chunks_, key >> chunk::k_shift);
+		if (it == chunks_.end() || it->high != key >> chunk::k_shift) {
+			it       = chunks_.emplace(it);
+			it->high = key >> chunk::k_shift;
+		}
+		if (!it->insert(static_cast<std::uint16_t>(key)))
+			return false;
+		count_++;
+		return true;
+	}
+	/**! Remove iCompIndex, returns false if it was not a member */
+	bool erase(link iCompIndex) {
+		std::size_t key = details::view_key<Container>(iCompIndex.value());
+		auto it         = chunk_at(chunks_, key >> chunk::k_shift);
+		if (it == chunks_.end() || it->high != key >> chunk::k_shift ||
+		    !it->erase(static_cast<std::uint16_t>(key)))
+			return false;
+		if (!it->count)
+			chunks_.erase(it);
+		count_--;
+		return true;
+	}
+	inline bool contains(link iCompIndex) const {
+		std::size_t key = details::view_key<Container>(iCompIndex.value());
+		auto it         = chunk_at(chunks_, key >> chunk::k_shift);
+		return it != chunks_.end() && it->high == key >> chunk::k_shift &&
+		       it->contains(static_cast<std::uint16_t>(key));
+	}
+	/**!
+	 * Position of iCompIndex in iteration order, k_null if it is not a
+	 * member. Costs a walk over the chunks before it.
+	 */
+	size_type find(link iCompIndex) const {
+		if (!contains(iCompIndex))
+			return details::constants<size_type>::k_null;
+		std::size_t key  = details::view_key<Container>(iCompIndex.value());
+		std::size_t rank = 0;
+		for (auto const& c : chunks_) {
+			if (c.high == key >> chunk::k_shift)
+				return static_cast<size_type>(
+				    rank + c.rank(static_cast<std::uint16_t>(key)));
+			rank += c.count;
+		}
+		return details::constants<size_type>::k_null;
+	}
+	inline void clear() noexcept {
+		chunks_.clear();
+		count_ = 0;
+	}
+
+	/**! Lambda called with the slot of each member, in slot order */
+	template <typename Lambda> void for_each_slot(Lambda&& iLambda) const {
+		for (auto const& c : chunks_) {
+			std::size_t base = c.high << chunk::k_shift;
+			c.for_each([&](std::uint16_t iLow) {
+				iLambda(static_cast<size_type>(base | iLow));
+			});
+		}
+	}
+	/**! Lambda called with each member object, in slot order */
+	template <typename Lambda> void for_each(Lambda&& iLambda) const {
+		Container& cont = container.get();
+		for_each_slot([&](size_type iSlot) { iLambda(cont.at_index(iSlot)); });
+	}
+
+	/**! Convert every chunk to its smallest form, runs included */
+	void optimize() {
+		for (auto& c : chunks_)
+			c.optimize();
+		chunks_.shrink_to_fit();
+	}
+	/**! Heap bytes held by the view */
+	std::size_t bytes() const noexcept {
+		std::size_t total = chunks_.capacity() * sizeof(chunk);
+		for (auto const& c : chunks_)
+			total += c.bytes();
+		return total;
+	}
+
+	/**! Keep the members of iOther only, chunk by chunk */
+	compressed_view& operator&=(compressed_view const& iOther) {
+		std::vector<chunk> result;
+		auto other = iOther.chunks_.begin();
+		for (auto const& c : chunks_) {
+			while (other != iOther.chunks_.end() && other->high < c.high)
+				++other;
+			if (other == iOther.chunks_.end())
+				break;
+			if (other->high != c.high)
+				continue;
+			chunk both = chunk::intersect(c, *other);
+			if (both.count)
+				result.push_back(std::move(both));
+		}
+		chunks_ = std::move(result);
+		count_  = 0;
+		for (auto const& c : chunks_)
+			count_ += static_cast<size_type>(c.count);
+		return *this;
+	}
+	friend compressed_view operator&(compressed_view iFirst,
+	                                 compressed_view const& iSecond) {
+		iFirst &= iSecond;
+		return iFirst;
+	}
+	/**!
+	 * Members of iView that are also in this view, in iView's order. The
+	 * chunk found for one link is reused while the next links fall in it.
+	 */
+	sorted_view<Container> intersect(sorted_view<Container> const& iView) const {
+		podvector<size_type> result;
+		auto c = chunks_.end();
+		for (auto value : iView.list()) {
+			std::size_t key  = details::view_key<Container>(value);
+			std::size_t high = key >> chunk::k_shift;
+			if (c == chunks_.end() || c->high != high) {
+				c = chunk_at(chunks_, high);
+				if (c != chunks_.end() && c->high != high)
+					c = chunks_.end();
+			}
+			if (c != chunks_.end() &&
+			    c->contains(static_cast<std::uint16_t>(key)))
+				result.push_back(value);
+		}
+		return sorted_view<Container>(container.get(), std::move(result));
+	}
+
+private:
+	/**! First chunk of iChunks whose high bits are not below iHigh */
+	template <typename Chunks>
+	static auto chunk_at(Chunks& iChunks, std::size_t iHigh) {
+		return std::lower_bound(iChunks.begin(), iChunks.end(), iHigh,
+		                        [](chunk const& iChunk, std::size_t iValue) {
+			                        return iChunk.high < iValue;
+		                        });
+	}
+
+	std::vector<chunk> chunks_;
+	std::reference_wrapper<Container> container;
+	size_type count_ = 0;
+};
+
+} // namespace cpptables
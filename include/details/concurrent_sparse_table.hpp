@@ -0,0 +1,386 @@
+#pragma once
+#include "basic_types.hpp"
+#include "epoch.hpp"
+#include "paged_storage.hpp"
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace cpptables {
+namespace details {
+
+/**!
+ * Sparse table whose insert, emplace and erase can be called from many
+ * threads at once without a lock. Free slots form a Treiber stack whose
+ * head carries a tag bumped by every change, so a slot popped and pushed
+ * back between a thread's read and its compare-exchange cannot be mistaken
+ * for an unchanged head (ABA). Every slot moves free -> live -> busy ->
+ * free through atomic transitions, a link erased twice is caught by the
+ * live -> busy compare-exchange.
+ *
+ * Slots live in pages reached through a directory sized once for iMaxSize
+ * slots, growing only publishes new pages so references and concurrent
+ * readers stay valid. at, try_at and for_each may run alongside inserts and
+ * erases of other objects; an object erased while another thread still
+ * uses it needs outside coordination.
+ *
+ * With Reclamation = with_epochs, erase retires the object instead: it is
+ * no longer visited or found, but is destroyed and its slot reused only
+ * once no reader pinned through make_reader() can still hold it. Readers
+ * then iterate and look up without locks while erases go on.
+ *
+ * Links carry no debug spoilers, try_at rejects erased slots instead.
+ */
+template <typename Ty, typename SizeType, typename Allocator, typename Backref,
+          typename Reclamation = no_reclamation, unsigned PageShift = 0>
+class concurrent_sparse_table : Allocator {
+	static_assert(sizeof(SizeType) <= sizeof(std::uint32_t),
+	              "Tagged free list head packs the slot index in 32 bits");
+
+	enum : std::uint8_t { k_free = 0, k_live = 1, k_busy = 2 };
+
+	struct no_stamp {};
+	struct no_epochs {
+		explicit no_epochs(std::size_t) noexcept {}
+	};
+	using stamp_type =
+	    std::conditional_t<Reclamation::value, std::uint64_t, no_stamp>;
+	using epochs_type =
+	    std::conditional_t<Reclamation::value, epoch_domain, no_epochs>;
+
+	struct slot {
+		std::atomic<SizeType> next{SizeType(0)};
+		std::atomic<std::uint8_t> state{k_free};
+		/**! Epoch the object was retired at */
+		[[no_unique_address]] stamp_type retired{};
+		alignas(Ty) std::byte storage[sizeof(Ty)];
+
+		inline Ty& get() noexcept {
+			return *std::launder(reinterpret_cast<Ty*>(storage));
+		}
+	};
+	using slot_allocator =
+	    typename std::allocator_traits<Allocator>::template rebind_alloc<slot>;
+	using head_type = std::uint64_t;
+
+public:
+	using value_type = Ty;
+	using size_type  = SizeType;
+	using this_type   = concurrent_sparse_table<Ty, SizeType, Allocator, Backref,
+	                                            Reclamation, PageShift>;
+	using reader      = epoch_domain::reader;
+	using link      = cpptables::link<Ty, SizeType>;
+	using constants = details::constants<size_type>;
+
+	enum : std::size_t {
+		k_page_shift = page_traits<slot, paged<PageShift>>::shift,
+		k_page_size  = std::size_t(1) << k_page_shift,
+		k_page_mask  = k_page_size - 1,
+		k_default_max_size = std::size_t(1) << 24,
+		// retired slots an erase lets pile up before it tries to reclaim
+		k_reclaim_threshold = 64
+	};
+
+	/**!
+	 * Room for at most iMaxSize slots, k_null - 1 at most, and iMaxReaders
+	 * readers claimed at once when reclaiming by epochs
+	 */
+	explicit concurrent_sparse_table(
+	    std::size_t iMaxSize    = k_default_max_size,
+	    std::size_t iMaxReaders = epoch_domain::k_default_readers)
+	    : max_size_(static_cast<size_type>(
+	          std::min<std::size_t>(iMaxSize, constants::k_null))),
+	      pages_((static_cast<std::size_t>(max_size_) + k_page_mask) >>
+	             k_page_shift),
+	      epochs_(Reclamation::value ? iMaxReaders : 0) {}
+	concurrent_sparse_table(concurrent_sparse_table const&) = delete;
+	concurrent_sparse_table& operator=(concurrent_sparse_table const&) = delete;
+	~concurrent_sparse_table() {
+		clear();
+		slot_allocator allocator(*this);
+		for (auto& page : pages_) {
+			slot* p = page.load(std::memory_order_relaxed);
+			if (p)
+				release_page(allocator, p);
+		}
+	}
+
+	/**!
+	 * Lambda called for each live object, Lambda should accept Ty& parameter.
+	 * Slots added while iterating may or may not be visited.
+	 */
+	template <typename Lambda> void for_each(Lambda&& iLambda) {
+		size_type end = range();
+		for (size_type i = 0; i < end; ++i) {
+			slot* s = find_slot(i);
+			if (!s) {
+				i |= static_cast<size_type>(k_page_mask);
+				continue;
+			}
+			if (s->state.load(std::memory_order_acquire) == k_live)
+				iLambda(s->get());
+		}
+	}
+	/**! Lambda called for each live object, see above */
+	template <typename Lambda> void for_each(Lambda&& iLambda) const {
+		const_cast<this_type*>(this)->for_each(
+		    [&](Ty& iObject) { iLambda(static_cast<Ty const&>(iObject)); });
+	}
+
+	/**! Total number of objects stored in the table */
+	size_type size() const noexcept {
+		return valid_count_.load(std::memory_order_relaxed);
+	}
+	/**! Slots handed out so far, free or live */
+	size_type range() const noexcept {
+		return size_.load(std::memory_order_acquire);
+	}
+	/**! Most slots the table can hold */
+	size_type max_size() const noexcept { return max_size_; }
+
+	/**!
+	 * Insert a copy of iObject. Returns a null link, and asserts, once
+	 * max_size() slots are live.
+	 */
+	inline link insert(Ty const& iObject) { return emplace(iObject); }
+	/**! Construct an object from iArgs, see insert */
+	template <typename... Args> link emplace(Args&&... iArgs) {
+		size_type index = acquire();
+		if (index == constants::k_null)
+			return link(constants::k_null);
+		slot& s = slot_at(index);
+		::new (static_cast<void*>(s.storage)) Ty(std::forward<Args>(iArgs)...);
+		Backref::template set_link<Ty, SizeType>(s.get(), link(index));
+		s.state.store(k_live, std::memory_order_release);
+		valid_count_.fetch_add(1, std::memory_order_relaxed);
+		return link(index);
+	}
+
+	/**!
+	 * Claim a reader for the calling thread, pin it around every section
+	 * that reads the table while others erase: auto guard = reader.pin();
+	 */
+	reader make_reader() {
+		static_assert(Reclamation::value, "Readers need with_epochs");
+		return epochs_.make_reader();
+	}
+	/**!
+	 * Destroy the retired objects no pinned reader can reach and free their
+	 * slots, returns how many were reclaimed. Erase calls it as retired
+	 * slots pile up, call it when erases stop to drain the rest.
+	 */
+	size_type reclaim() {
+		if constexpr (Reclamation::value) {
+			std::uint64_t epoch = epochs_.try_advance();
+			size_type id = retired_.exchange(constants::k_null,
+			                                 std::memory_order_acquire);
+			size_type keep = constants::k_null, keep_tail = constants::k_null;
+			size_type count = 0;
+			while (id != constants::k_null) {
+				slot& s      = slot_at(id);
+				size_type next = s.next.load(std::memory_order_relaxed);
+				if (epoch_domain::reclaimable(s.retired, epoch)) {
+					s.get().~Ty();
+					s.state.store(k_free, std::memory_order_relaxed);
+					release(id);
+					count++;
+				} else {
+					s.next.store(keep, std::memory_order_relaxed);
+					if (keep == constants::k_null)
+						keep_tail = id;
+					keep = id;
+				}
+				id = next;
+			}
+			if (keep != constants::k_null)
+				retire_chain(keep, keep_tail);
+			retired_count_.fetch_sub(count, std::memory_order_relaxed);
+			return count;
+		} else {
+			return 0;
+		}
+	}
+	/**! Erased objects waiting for readers to move on */
+	size_type retired() const noexcept {
+		return retired_count_.load(std::memory_order_relaxed);
+	}
+
+	/**! Erase the object, returns false if it was not live */
+	bool erase(link iIndex) {
+		size_type id = iIndex.value();
+		if (id >= range() || !find_slot(id))
+			return false;
+		slot& s            = slot_at(id);
+		std::uint8_t state = k_live;
+		if (!s.state.compare_exchange_strong(state, k_busy,
+		                                     std::memory_order_acq_rel))
+			return false;
+		valid_count_.fetch_sub(1, std::memory_order_relaxed);
+		if constexpr (Reclamation::value) {
+			// readers that saw the object live pinned an epoch <= this one
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			s.retired = epochs_.epoch();
+			retire_chain(id, id);
+			if (retired_count_.fetch_add(1, std::memory_order_relaxed) + 1 >=
+			    k_reclaim_threshold)
+				reclaim();
+		} else {
+			s.get().~Ty();
+			s.state.store(k_free, std::memory_order_relaxed);
+			release(id);
+		}
+		return true;
+	}
+	/**! Erase an object through its backref */
+	bool erase(Ty const& iObject) {
+		static_assert(has_backref_v<Backref>,
+		              "Not supported without backreference");
+		return erase(Backref::template get_link<Ty, SizeType>(iObject));
+	}
+
+	inline Ty& at(link iIndex) {
+		slot& s = slot_at(iIndex.value());
+		assert(s.state.load(std::memory_order_acquire) == k_live);
+		return s.get();
+	}
+	inline Ty const& at(link iIndex) const {
+		return const_cast<this_type*>(this)->at(iIndex);
+	}
+	/**! Object at iIndex or nullptr if the slot is not live */
+	inline Ty* try_at(link iIndex) noexcept {
+		size_type id = iIndex.value();
+		if (id >= range())
+			return nullptr;
+		slot* s = find_slot(id);
+		if (!s || s->state.load(std::memory_order_acquire) != k_live)
+			return nullptr;
+		return &s->get();
+	}
+	/**! Object at iIndex or nullptr, see try_at */
+	inline Ty const* try_at(link iIndex) const noexcept {
+		return const_cast<this_type*>(this)->try_at(iIndex);
+	}
+
+	/**!
+	 * Destroy every object, retired ones included. Not safe against
+	 * concurrent calls or pinned readers.
+	 */
+	void clear() {
+		size_type end = range();
+		for (size_type i = 0; i < end; ++i) {
+			slot* s = find_slot(i);
+			if (s && s->state.load(std::memory_order_relaxed) != k_free) {
+				s->get().~Ty();
+				s->state.store(k_free, std::memory_order_relaxed);
+			}
+		}
+		head_.store(pack(constants::k_null, 0), std::memory_order_relaxed);
+		size_.store(0, std::memory_order_relaxed);
+		valid_count_.store(0, std::memory_order_relaxed);
+		retired_.store(constants::k_null, std::memory_order_relaxed);
+		retired_count_.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	static inline head_type pack(size_type iIndex, head_type iTag) noexcept {
+		return (iTag << 32) | iIndex;
+	}
+	static inline size_type index_of(head_type iHead) noexcept {
+		return static_cast<size_type>(iHead & 0xffffffffu);
+	}
+	static inline head_type tag_of(head_type iHead) noexcept {
+		return iHead >> 32;
+	}
+
+	/**! Pop a free slot, or hand out a new one past range() */
+	size_type acquire() {
+		head_type head = head_.load(std::memory_order_acquire);
+		while (index_of(head) != constants::k_null) {
+			size_type next =
+			    slot_at(index_of(head)).next.load(std::memory_order_relaxed);
+			if (head_.compare_exchange_weak(head, pack(next, tag_of(head) + 1),
+			                                std::memory_order_acquire,
+			                                std::memory_order_acquire))
+				return index_of(head);
+		}
+		size_type index = size_.load(std::memory_order_relaxed);
+		do {
+			if (index >= max_size_) {
+				assert(false && "concurrent table is full");
+				return constants::k_null;
+			}
+		} while (!size_.compare_exchange_weak(index, index + 1,
+		                                      std::memory_order_relaxed));
+		publish_page(index >> k_page_shift);
+		return index;
+	}
+	/**! Push slot iIndex on the free list */
+	void release(size_type iIndex) {
+		slot& s        = slot_at(iIndex);
+		head_type head = head_.load(std::memory_order_relaxed);
+		do {
+			s.next.store(index_of(head), std::memory_order_relaxed);
+		} while (!head_.compare_exchange_weak(head,
+		                                      pack(iIndex, tag_of(head) + 1),
+		                                      std::memory_order_release,
+		                                      std::memory_order_relaxed));
+	}
+
+	/**!
+	 * Push the chain iFirst .. iLast, linked through next, on the retired
+	 * list. Entries only leave it all at once through exchange, so the
+	 * plain index head is free of ABA.
+	 */
+	void retire_chain(size_type iFirst, size_type iLast) {
+		slot& last     = slot_at(iLast);
+		size_type head = retired_.load(std::memory_order_relaxed);
+		do {
+			last.next.store(head, std::memory_order_relaxed);
+		} while (!retired_.compare_exchange_weak(head, iFirst,
+		                                         std::memory_order_release,
+		                                         std::memory_order_relaxed));
+	}
+
+	/**! Allocate page iPage unless another thread already did */
+	void publish_page(std::size_t iPage) {
+		if (pages_[iPage].load(std::memory_order_acquire))
+			return;
+		slot_allocator allocator(*this);
+		slot* fresh = allocator.allocate(k_page_size);
+		for (std::size_t i = 0; i < k_page_size; ++i)
+			::new (static_cast<void*>(fresh + i)) slot();
+		slot* expected = nullptr;
+		if (!pages_[iPage].compare_exchange_strong(expected, fresh,
+		                                           std::memory_order_acq_rel))
+			release_page(allocator, fresh);
+	}
+	static void release_page(slot_allocator& iAllocator, slot* iPage) {
+		for (std::size_t i = 0; i < k_page_size; ++i)
+			iPage[i].~slot();
+		iAllocator.deallocate(iPage, k_page_size);
+	}
+
+	/**! Slot iIndex, nullptr while its page is not published yet */
+	inline slot* find_slot(size_type iIndex) const noexcept {
+		slot* page = pages_[iIndex >> k_page_shift].load(std::memory_order_acquire);
+		return page ? page + (iIndex & k_page_mask) : nullptr;
+	}
+	inline slot& slot_at(size_type iIndex) const noexcept {
+		return pages_[iIndex >> k_page_shift].load(
+		    std::memory_order_acquire)[iIndex & k_page_mask];
+	}
+
+	size_type max_size_;
+	std::vector<std::atomic<slot*>> pages_;
+	std::atomic<head_type> head_{pack(constants::k_null, 0)};
+	std::atomic<size_type> size_{0};
+	std::atomic<size_type> valid_count_{0};
+	std::atomic<size_type> retired_{constants::k_null};
+	std::atomic<size_type> retired_count_{0};
+	[[no_unique_address]] epochs_type epochs_;
+};
+
+} // namespace details
+} // namespace cpptables
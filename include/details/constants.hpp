@@ -7,7 +7,31 @@
 namespace cpptables {
 namespace details {
 
+/**!
+ * k_spoiler_max masks the debug spoiler kept per slot, a link carries it in
+ * the k_spoiler_mask bits above the slot index. Generational tables keep the
+ * slot generation there in every build, so they hold at most k_index_mask
+ * slots and inserts past that return a null link.
+ */
 template <typename SizeType> struct constants {};
+/**!
+ * Small tables, up to 0x7ffe slots. Debug builds keep 3 spoiler bits and
+ * the index in the low 12 bits, which limits them to 4096 slots: inserting
+ * past that asserts in CPPTABLES_DEBUG builds while release builds accept
+ * it. Size debug builds of 16 bit tables for 4096 slots, or test with a
+ * wider SizeType. Generational tables are held to 4095 slots in every build.
+ */
+template <> struct constants<std::uint16_t> {
+	enum : std::uint16_t {
+		k_null          = 0x7fff,
+		k_invalid_bit   = 0x8000,
+		k_link_mask     = 0x7fff,
+		k_spoiler_mask  = 0x7000,
+		k_index_mask    = 0x0fff,
+		k_spoiler_shift = 12,
+		k_spoiler_max   = 0x7
+	};
+};
 template <> struct constants<std::uint32_t> {
 	enum : std::uint32_t {
 		k_null          = 0x7fffffff,
@@ -15,7 +39,8 @@ template <> struct constants<std::uint32_t> {
 		k_link_mask     = 0x7fffffff,
 		k_spoiler_mask  = 0x7f000000,
 		k_index_mask    = 0x00ffffff,
-		k_spoiler_shift = 24
+		k_spoiler_shift = 24,
+		k_spoiler_max   = 0x7f
 	};
 };
 template <> struct constants<std::uint64_t> {
@@ -24,8 +49,9 @@ template <> struct constants<std::uint64_t> {
 		k_invalid_bit   = 0x8000000000000000,
 		k_link_mask     = 0x7fffffffffffffff,
 		k_spoiler_mask  = 0x7f00000000000000,
-		k_index_mask    = 0xff00000000000000,
-		k_spoiler_shift = 56
+		k_index_mask    = 0x00ffffffffffffff,
+		k_spoiler_shift = 56,
+		k_spoiler_max   = 0x7f
 	};
 };
 
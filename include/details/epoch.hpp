@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace cpptables {
+
+/**!
+ * Epoch based reclamation. Readers pin the current epoch while they hold
+ * references into a table, writers stamp what they retire with the epoch
+ * at retirement. The epoch only advances once every pinned reader has seen
+ * it, so a slot retired at epoch e is unreachable by any reader once the
+ * epoch reaches e + 2.
+ *
+ * Each reader thread claims a reader once and pins it around every read
+ * section. A reader pinned for long holds back all reclamation.
+ */
+class epoch_domain {
+	struct alignas(64) announcement {
+		std::atomic<std::uint64_t> epoch{k_idle};
+		std::atomic<bool> claimed{false};
+	};
+
+public:
+	enum : std::uint64_t { k_idle = ~std::uint64_t(0) };
+	enum : std::size_t { k_default_readers = 64 };
+
+	class reader;
+	/**! Keeps a reader pinned while alive, see reader::pin */
+	class guard {
+	public:
+		guard(guard const&)            = delete;
+		guard& operator=(guard const&) = delete;
+		~guard() { reader_.unpin(); }
+
+	private:
+		friend class reader;
+		explicit guard(reader& iReader) : reader_(iReader) { reader_.enter(); }
+		reader& reader_;
+	};
+
+	/**! A claimed reader slot, owned by one thread at a time */
+	class reader {
+	public:
+		reader() = default;
+		reader(reader&& iOther) noexcept
+		    : domain_(std::exchange(iOther.domain_, nullptr)),
+		      slot_(iOther.slot_), depth_(std::exchange(iOther.depth_, 0)) {}
+		reader& operator=(reader&& iOther) noexcept {
+			release();
+			domain_ = std::exchange(iOther.domain_, nullptr);
+			slot_   = iOther.slot_;
+			depth_  = std::exchange(iOther.depth_, 0);
+			return *this;
+		}
+		~reader() { release(); }
+
+		/**! False when the domain had no reader slot left */
+		explicit operator bool() const noexcept { return domain_ != nullptr; }
+		/**! Pin the current epoch until the guard goes, pins may nest */
+		[[nodiscard]] guard pin() { return guard(*this); }
+
+	private:
+		friend class epoch_domain;
+		friend class guard;
+		reader(epoch_domain* iDomain, std::size_t iSlot)
+		    : domain_(iDomain), slot_(iSlot) {}
+
+		void enter() {
+			assert(domain_ && "Reader holds no slot");
+			if (depth_++)
+				return;
+			auto& epoch = domain_->readers_[slot_].epoch;
+			epoch.store(domain_->epoch_.load(std::memory_order_seq_cst),
+			            std::memory_order_seq_cst);
+			// reads of the section must not move above the announcement
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+		void unpin() {
+			if (--depth_)
+				return;
+			domain_->readers_[slot_].epoch.store(k_idle,
+			                                     std::memory_order_release);
+		}
+		void release() {
+			if (!domain_)
+				return;
+			assert(!depth_ && "Reader released while pinned");
+			auto& a = domain_->readers_[slot_];
+			a.epoch.store(k_idle, std::memory_order_release);
+			a.claimed.store(false, std::memory_order_release);
+			domain_ = nullptr;
+		}
+
+		epoch_domain* domain_ = nullptr;
+		std::size_t slot_     = 0;
+		std::uint32_t depth_  = 0;
+	};
+
+	/**! Room for iMaxReaders readers claimed at the same time */
+	explicit epoch_domain(std::size_t iMaxReaders = k_default_readers)
+	    : readers_(std::make_unique<announcement[]>(iMaxReaders)),
+	      reader_count_(iMaxReaders) {}
+	epoch_domain(epoch_domain const&)            = delete;
+	epoch_domain& operator=(epoch_domain const&) = delete;
+
+	/**! Claim a reader slot, the reader is empty if all are taken */
+	reader make_reader() {
+		for (std::size_t i = 0; i < reader_count_; ++i) {
+			bool expected = false;
+			if (readers_[i].claimed.compare_exchange_strong(
+			        expected, true, std::memory_order_acquire))
+				return reader(this, i);
+		}
+		assert(false && "No reader slot left in the epoch domain");
+		return reader();
+	}
+
+	std::uint64_t epoch() const noexcept {
+		return epoch_.load(std::memory_order_seq_cst);
+	}
+	/**!
+	 * Move to the next epoch if every pinned reader has seen the current
+	 * one, returns the epoch after the attempt
+	 */
+	std::uint64_t try_advance() noexcept {
+		std::uint64_t current = epoch_.load(std::memory_order_seq_cst);
+		for (std::size_t i = 0; i < reader_count_; ++i) {
+			std::uint64_t seen =
+			    readers_[i].epoch.load(std::memory_order_seq_cst);
+			if (seen != k_idle && seen != current)
+				return current;
+		}
+		if (epoch_.compare_exchange_strong(current, current + 1,
+		                                   std::memory_order_seq_cst))
+			return current + 1;
+		return current;
+	}
+	/**! True once nothing retired at iRetired can still be reached */
+	static bool reclaimable(std::uint64_t iRetired,
+	                        std::uint64_t iEpoch) noexcept {
+		return iEpoch - iRetired >= 2;
+	}
+
+private:
+	std::unique_ptr<announcement[]> readers_;
+	std::size_t reader_count_;
+	std::atomic<std::uint64_t> epoch_{0};
+};
+
+} // namespace cpptables
@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace cpptables {
+
+/**!
+ * Growth policies decide the new capacity when a container runs out of
+ * slots. A policy exposes:
+ *   static SizeType grow(SizeType iSize,
+ *                        std::type_identity_t<SizeType> iNeeded,
+ *                        std::size_t iElementSize);
+ * returning a capacity of at least iNeeded. SizeType is deduced from iSize
+ * alone, so iSize + 1 promoted to int still matches for 16 bit sizes.
+ */
+namespace details {
+
+template <typename SizeType>
+constexpr SizeType clamp_capacity(std::size_t iCapacity) noexcept {
+	return static_cast<SizeType>(std::min<std::size_t>(
+	    iCapacity, std::numeric_limits<SizeType>::max()));
+}
+
+} // namespace details
+
+/**! Grow by half the current size, the default */
+struct grow_1_5x {
+	template <typename SizeType>
+	static constexpr SizeType grow(SizeType iSize,
+	                               std::type_identity_t<SizeType> iNeeded,
+	                               std::size_t) noexcept {
+		std::size_t size = iSize;
+		return details::clamp_capacity<SizeType>(std::max<std::size_t>(
+		    iNeeded, size + std::max<std::size_t>(size >> 1, 1)));
+	}
+};
+
+/**! Double the current size */
+struct grow_2x {
+	template <typename SizeType>
+	static constexpr SizeType grow(SizeType iSize,
+	                               std::type_identity_t<SizeType> iNeeded,
+	                               std::size_t) noexcept {
+		std::size_t size = iSize;
+		return details::clamp_capacity<SizeType>(std::max<std::size_t>(
+		    iNeeded, size + std::max<std::size_t>(size, 1)));
+	}
+};
+
+/**! Grow by Step slots at a time, for tables with a known steady size */
+template <std::size_t Step> struct grow_fixed {
+	static_assert(Step > 0, "Step must be at least one slot");
+	template <typename SizeType>
+	static constexpr SizeType grow(SizeType iSize,
+	                               std::type_identity_t<SizeType> iNeeded,
+	                               std::size_t) noexcept {
+		std::size_t steps =
+		    (static_cast<std::size_t>(iNeeded) - iSize + Step - 1) / Step;
+		return details::clamp_capacity<SizeType>(iSize + steps * Step);
+	}
+};
+
+/**!
+ * Base decides the capacity, which is then raised to as many slots as fit
+ * in whole PageBytes pages. With 2MB pages, huge page backed tables leave
+ * no unused tail page.
+ */
+template <std::size_t PageBytes = 4096, typename Base = grow_1_5x>
+struct grow_page_rounded {
+	static_assert(std::has_single_bit(PageBytes),
+	              "PageBytes must be a power of two");
+	template <typename SizeType>
+	static constexpr SizeType grow(SizeType iSize,
+	                               std::type_identity_t<SizeType> iNeeded,
+	                               std::size_t iElementSize) noexcept {
+		std::size_t bytes =
+		    static_cast<std::size_t>(Base::grow(iSize, iNeeded, iElementSize)) *
+		    iElementSize;
+		bytes = (bytes + PageBytes - 1) & ~(PageBytes - 1);
+		return details::clamp_capacity<SizeType>(bytes / iElementSize);
+	}
+};
+
+/**!
+ * Base decides the capacity, which is then rounded up to the size class a
+ * jemalloc/tcmalloc style allocator would hand out anyway: four classes per
+ * power of two, 16 byte steps for small blocks.
+ */
+template <typename Base = grow_1_5x> struct grow_size_class {
+	template <typename SizeType>
+	static constexpr SizeType grow(SizeType iSize,
+	                               std::type_identity_t<SizeType> iNeeded,
+	                               std::size_t iElementSize) noexcept {
+		std::size_t bytes =
+		    static_cast<std::size_t>(Base::grow(iSize, iNeeded, iElementSize)) *
+		    iElementSize;
+		std::size_t spacing = 16;
+		if (bytes > 64)
+			spacing = std::bit_floor(bytes - 1) >> 2;
+		bytes = (bytes + spacing - 1) & ~(spacing - 1);
+		return details::clamp_capacity<SizeType>(bytes / iElementSize);
+	}
+};
+
+/**!
+ * Growth used by every container holding Ty unless a policy is passed
+ * explicitly, specialize to change it for a type across all table flavours
+ */
+template <typename Ty> struct growth_policy {
+	using type = grow_1_5x;
+};
+
+template <typename Ty>
+using growth_policy_t = typename growth_policy<Ty>::type;
+
+} // namespace cpptables
@@ -0,0 +1,49 @@
+#pragma once
+#include <algorithm>
+#include <span>
+#include <vector>
+
+namespace cpptables {
+
+/**!
+ * Old link to new link pairs produced by table compaction. Entries are kept
+ * sorted by the old link so external holders can be patched with a binary
+ * search each, or by walking entries() in one pass.
+ */
+template <typename Link> class link_remap {
+public:
+	struct entry {
+		Link from;
+		Link to;
+	};
+
+	/**! Rewrite ioLink if its object was moved, returns true if it was */
+	bool patch(Link& ioLink) const {
+		auto it = std::lower_bound(
+		    entries_.begin(), entries_.end(), ioLink,
+		    [](entry const& iEntry, Link iLink) { return iEntry.from < iLink; });
+		if (it == entries_.end() || it->from != ioLink)
+			return false;
+		ioLink = it->to;
+		return true;
+	}
+
+	std::span<entry const> entries() const noexcept { return entries_; }
+	std::size_t size() const noexcept { return entries_.size(); }
+	bool empty() const noexcept { return entries_.empty(); }
+	void clear() noexcept { entries_.clear(); }
+
+	/**! Record a move, call sort once all moves are recorded */
+	void add(Link iFrom, Link iTo) { entries_.push_back({iFrom, iTo}); }
+	void sort() {
+		std::sort(entries_.begin(), entries_.end(),
+		          [](entry const& iFirst, entry const& iSecond) {
+			          return iFirst.from < iSecond.from;
+		          });
+	}
+
+private:
+	std::vector<entry> entries_;
+};
+
+} // namespace cpptables
@@ -1,12 +1,19 @@
 #pragma once
 #include "basic_types.hpp"
+#include "cold_storage.hpp"
+#include "parallel.hpp"
+#include "prefetch.hpp"
 #include "podvector.hpp"
+#include <span>
+#include <stdexcept>
 #include <vector>
 
 namespace cpptables {
 namespace details {
 
-template <typename Ty, typename SizeType, typename Allocator, typename Backref>
+template <typename Ty, typename SizeType, typename Allocator, typename Backref,
+          typename ReverseMap = std::true_type, typename Cold = void,
+          typename Generation = no_generations>
 class packed_table_with_indirection {
 	using vector_t = std::conditional_t<std::is_trivially_copyable_v<Ty>,
 	                                    podvector<Ty, Allocator, SizeType>,
@@ -16,7 +23,8 @@ public:
 	using value_type = Ty;
 	using size_type  = SizeType;
 	using this_type =
-	    packed_table_with_indirection<Ty, SizeType, Allocator, Backref>;
+	    packed_table_with_indirection<Ty, SizeType, Allocator, Backref,
+	                                  ReverseMap, Cold, Generation>;
 	using link                   = cpptables::link<Ty, SizeType>;
 	using constants              = details::constants<size_type>;
 	using index_t                = details::index_t<size_type>;
@@ -25,6 +33,31 @@ public:
 	using reverse_iterator       = typename vector_t::reverse_iterator;
 	using const_reverse_iterator = typename vector_t::const_reverse_iterator;
 
+	/**!
+	 * Without a backref, erase needs the link slot of the back item it moves.
+	 * The reverse map keeps it per item position so erase stays O(1), at the
+	 * cost of one size_type per item. Without it the slot is searched for.
+	 */
+	static constexpr bool k_reverse_map =
+	    !has_backref_v<Backref> && ReverseMap::value;
+	/**!
+	 * With a Cold type each item also has a Cold object in a parallel vector
+	 * moved along with it, Ty is the hot part walked by for_each and Cold is
+	 * only reached through cold() or for_each_hot_cold
+	 */
+	using cold_type              = Cold;
+	static constexpr bool k_cold = !std::is_void_v<Cold>;
+	/**!
+	 * With generations the indirection entry keeps the slot generation in its
+	 * spoiler bits next to the item location, a link is checked against it
+	 * with the load that finds the item
+	 */
+	static constexpr bool k_generational = Generation::value;
+	static constexpr size_type k_generation_mask =
+	    k_generational ? size_type(constants::k_spoiler_mask) : size_type(0);
+	static_assert(!k_generational || has_backref_v<Backref> || k_reverse_map,
+	              "Generations need a backref or the reverse map");
+
 	/**!
 	 * Make a non-const table view of some type
 	 */
@@ -64,6 +97,70 @@ public:
 	void for_each(size_type iBeg, size_type iEnd, Lambda&& iLambda) const {
 		this_type::for_each(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
 	}
+	/**!
+	 * Lambda called for the hot part of each element, same as for_each
+	 */
+	template <typename Lambda> void for_each_hot(Lambda&& iLambda) {
+		this_type::for_each(*this, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for the hot part of each element, same as for_each
+	 */
+	template <typename Lambda> void for_each_hot(Lambda&& iLambda) const {
+		this_type::for_each(*this, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for each element, Lambda should accept (Ty&, Cold&)
+	 */
+	template <typename Lambda>
+	void for_each_hot_cold(Lambda&& iLambda) requires k_cold {
+		for (size_type i = 0, end = size(); i < end; ++i)
+			std::forward<Lambda>(iLambda)(items[i], cold_items[i]);
+	}
+	/**!
+	 * Lambda called for each element, Lambda should accept
+	 * (Ty const&, Cold const&)
+	 */
+	template <typename Lambda>
+	void for_each_hot_cold(Lambda&& iLambda) const requires k_cold {
+		for (size_type i = 0, end = size(); i < end; ++i)
+			std::forward<Lambda>(iLambda)(items[i], cold_items[i]);
+	}
+	/**! details::parallel_for_each, on iExec or the default thread pool */
+	template <typename Executor, typename Lambda>
+	void parallel_for_each(Executor& iExec, Lambda&& iLambda) {
+		details::parallel_for_each(*this, iExec, std::forward<Lambda>(iLambda));
+	}
+	template <typename Executor, typename Lambda>
+	void parallel_for_each(Executor& iExec, Lambda&& iLambda) const {
+		details::parallel_for_each(*this, iExec, std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void parallel_for_each(Lambda&& iLambda) {
+		details::parallel_for_each(*this, default_thread_pool(),
+		                           std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void parallel_for_each(Lambda&& iLambda) const {
+		details::parallel_for_each(*this, default_thread_pool(),
+		                           std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called with a std::span<Ty>, std::span<Ty const> when const, for
+	 * each maximal run of contiguous live objects in [iBeg, iEnd) or range()
+	 */
+	template <typename Lambda> void for_each_run(Lambda&& iLambda) {
+		this_type::for_each_run(*this, 0, range(), std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void for_each_run(Lambda&& iLambda) const {
+		this_type::for_each_run(*this, 0, range(), std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda>
+	void for_each_run(size_type iBeg, size_type iEnd, Lambda&& iLambda) {
+		this_type::for_each_run(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda>
+	void for_each_run(size_type iBeg, size_type iEnd, Lambda&& iLambda) const {
+		this_type::for_each_run(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
 	/**! Total number of objects stored in the table */
 	size_type size() const noexcept {
 		return static_cast<size_type>(items.size());
@@ -74,37 +171,76 @@ public:
 	}
 	/**! Total number of slots to effieiencyl do parallel iteration */
 	size_type range() const noexcept { return size(); }
+	/**! Number of live objects in slots [iBeg, iEnd) */
+	size_type live_count(size_type iBeg, size_type iEnd) const {
+		return iBeg < iEnd ? iEnd - iBeg : 0;
+	}
 	/**! Insert an object */
 	link insert(Ty const& iObject) noexcept {
+		if (out_of_links())
+			return link();
 		SizeType location = static_cast<SizeType>(items.size());
 		items.push_back(iObject);
+		cold_items.emplace_back();
+		return do_insert(location);
+	}
+	/**! Insert the hot and the cold part of an object */
+	template <typename C = Cold>
+	link insert(Ty const& iObject, C const& iCold) noexcept requires k_cold {
+		if (out_of_links())
+			return link();
+		SizeType location = static_cast<SizeType>(items.size());
+		items.push_back(iObject);
+		cold_items.push_back(iCold);
 		return do_insert(location);
 	}
 	/**! Emplace an object */
 	template <typename... Args> link emplace(Args&&... iArgs) noexcept {
+		if (out_of_links())
+			return link();
 		SizeType location = static_cast<SizeType>(items.size());
 		items.emplace_back(std::forward<Args>(iArgs)...);
+		cold_items.emplace_back();
 		return do_insert(location);
 	}
-	/**! Erase an object */
-	void erase(link iIndex) {
+	/**! Erase an object, false if the link is stale (with generations) */
+	bool erase(link iIndex) {
 		SizeType id = iIndex.value();
+		if constexpr (k_generational) {
+			id &= constants::k_index_mask;
+			if (id >= indirection.size() ||
+			    !is_live(indirection[id], iIndex.value()))
+				return false;
+		}
 #ifdef CPPTABLES_DEBUG
-		index_t index(id);
+		index_t index(iIndex.value());
 		id = index.index();
 		assert(spoilers[id] == index.spoiler());
-		spoilers[id] = (spoilers[id] + 1) & 0x7f;
+		spoilers[id] = (spoilers[id] + 1) & constants::k_spoiler_max;
 #endif
-		if (has_backref_v<Backref>) {
+		size_type location = location_of(indirection[id]);
+		if constexpr (k_cold)
+			cold_items[location] = std::move(cold_items.back());
+		cold_items.pop_back();
+		if constexpr (has_backref_v<Backref>) {
 			SizeType end_l = (SizeType)get_link(items.back());
 #ifdef CPPTABLES_DEBUG
 			index_t end_index(end_l);
 			end_l = end_index.index();
 #endif
-			items[indirection[id]] = std::move(items.back());
+			if constexpr (k_generational)
+				end_l &= constants::k_index_mask;
+			items[location] = std::move(items.back());
 			items.pop_back();
-			indirection[end_l] = indirection[id];
+			indirection[end_l] = (indirection[end_l] & k_generation_mask) | location;
 
+		} else if constexpr (k_reverse_map) {
+			size_type end_l               = reverse_indirection.back();
+			items[location]               = std::move(items.back());
+			indirection[end_l] = (indirection[end_l] & k_generation_mask) | location;
+			reverse_indirection[location] = end_l;
+			items.pop_back();
+			reverse_indirection.pop_back();
 		} else {
 			items[indirection[id]] = std::move(items.back());
 			items.pop_back();
@@ -122,30 +258,107 @@ public:
 				}
 			}
 		}
-		indirection[id]  = first_free_index | constants::k_invalid_bit;
+		indirection[id]  = free_entry(indirection[id], first_free_index);
 		first_free_index = id;
+		return true;
 	}
 
 	/**! Erase an object */
-	/*std::enable_if_t<has_backref_v<Backref>>void*/ void erase(
+	/*std::enable_if_t<has_backref_v<Backref>>void*/ bool erase(
 	    Ty const& iObject) {
 		assert(has_backref_v<Backref> && "Not supported without backreference");
-		erase(Backref::template get_link<value_type, size_type>(iObject));
+		return erase(Backref::template get_link<value_type, size_type>(iObject));
 	}
-	/**! Locate an object using its link */
+	/**!
+	 * Locate an object using its link, with generations a stale link throws
+	 * std::out_of_range
+	 */
 	inline Ty& at(link iIndex) {
 		SizeType id = iIndex.value();
+		if constexpr (k_generational) {
+			id &= constants::k_index_mask;
+			if (id >= indirection.size() ||
+			    !is_live(indirection[id], iIndex.value()))
+				throw std::out_of_range("Stale link");
+		}
 #ifdef CPPTABLES_DEBUG
-		index_t index(id);
+		index_t index(iIndex.value());
 		id = index.index();
 		assert(spoilers[id] == index.spoiler());
 #endif
-		return items[indirection[id]];
+		return items[location_of(indirection[id])];
 	}
 	/**! Locate an object using its link */
 	inline Ty const& at(link iIndex) const {
 		return const_cast<Ty const&>(const_cast<this_type*>(this)->at(iIndex));
 	}
+	/**!
+	 * Object at iIndex or nullptr if the link is out of range or its object
+	 * was erased. Stale links are only caught with generations.
+	 */
+	inline Ty* try_at(link iIndex) noexcept {
+		size_type id = iIndex.value();
+#ifdef CPPTABLES_DEBUG
+		index_t index(id);
+		id = index.index();
+		if (id < indirection.size() && spoilers[id] != index.spoiler())
+			return nullptr;
+#endif
+		if constexpr (k_generational)
+			id &= constants::k_index_mask;
+		if (id >= indirection.size() || !is_live(indirection[id], iIndex.value()))
+			return nullptr;
+		return &items[location_of(indirection[id])];
+	}
+	/**! Object at iIndex or nullptr, see try_at */
+	inline Ty const* try_at(link iIndex) const noexcept {
+		return const_cast<this_type*>(this)->try_at(iIndex);
+	}
+	/**!
+	 * Lambda called with the object of each link in iLinks, in order.
+	 * Indirection entries are prefetched 2 * Distance and objects Distance
+	 * links ahead so the cache misses of random lookups overlap.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) {
+		details::prefetched_walk<Distance>(
+		    iLinks, [this](link iLink) { prefetch_entry(iLink); },
+		    [this](link iLink) { prefetch_link(iLink); },
+		    [&](link iLink) { iLambda(at(iLink)); });
+	}
+	/**! Lambda called with the object of each link in iLinks, in order */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) const {
+		const_cast<this_type*>(this)->template for_each_link<Distance>(
+		    iLinks, [&](Ty const& iObject) { iLambda(iObject); });
+	}
+	/**!
+	 * Copy the objects of iLinks to oOutput in order, prefetching like
+	 * for_each_link. Returns the iterator past the last copy.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename OutputIt>
+	OutputIt gather(std::span<link const> iLinks, OutputIt oOutput) const {
+		for_each_link<Distance>(iLinks,
+		                        [&](Ty const& iObject) { *oOutput++ = iObject; });
+		return oOutput;
+	}
+	/**! Cold part of the object at iIndex */
+	template <typename C = Cold> inline C& cold(link iIndex) requires k_cold {
+		SizeType id = iIndex.value();
+#ifdef CPPTABLES_DEBUG
+		index_t index(id);
+		id = index.index();
+		assert(spoilers[id] == index.spoiler());
+#endif
+		if constexpr (k_generational)
+			id &= constants::k_index_mask;
+		return cold_items[location_of(indirection[id])];
+	}
+	/**! Cold part of the object at iIndex */
+	template <typename C = Cold>
+	inline C const& cold(link iIndex) const requires k_cold {
+		return const_cast<this_type*>(this)->cold(iIndex);
+	}
 
 	// Iterators
 	iterator begin() { return items.begin(); }
@@ -167,16 +380,108 @@ public:
 
 	void clear() {
 		items.clear();
-		indirection.clear();
+		cold_items.clear();
+		reverse_indirection.clear();
+		first_free_index = constants::k_null;
+		if constexpr (k_generational) {
+			// entries stay, all free, so old links remain stale
+			for (size_type i = static_cast<size_type>(indirection.size());
+			     i-- > 0;) {
+				size_type entry = indirection[i];
+				if (!(entry & constants::k_invalid_bit)) {
+					entry = free_entry(entry, constants::k_null);
 #ifdef CPPTABLES_DEBUG
-		spoilers.clear();
+					spoilers[i] = (spoilers[i] + 1) & constants::k_spoiler_max;
 #endif
-		first_free_index = constants::k_null;
+				}
+				indirection[i] = static_cast<size_type>(
+				    (entry & (size_type(constants::k_invalid_bit) | k_generation_mask)) |
+				    (first_free_index == constants::k_null
+				         ? static_cast<size_type>(constants::k_index_mask)
+				         : first_free_index));
+				first_free_index = i;
+			}
+		} else {
+			indirection.clear();
+#ifdef CPPTABLES_DEBUG
+			spoilers.clear();
+#endif
+		}
 	}
 
 private:
+	/**! Item location held by a live indirection entry */
+	static inline size_type location_of(size_type iEntry) noexcept {
+		if constexpr (k_generational)
+			return iEntry & constants::k_index_mask;
+		else
+			return iEntry;
+	}
+	/**! Indirection entry of iLink, the link is not checked */
+	static inline size_type entry_of(link iLink) noexcept {
+		size_type id = index_t(iLink.value()).index();
+		if constexpr (k_generational)
+			id &= constants::k_index_mask;
+		return id;
+	}
+	/**! Prefetch the indirection entry of iLink */
+	inline void prefetch_entry(link iLink) const noexcept {
+		details::prefetch(&indirection[entry_of(iLink)]);
+	}
+	/**! Prefetch the object of iLink, reads its indirection entry */
+	inline void prefetch_link(link iLink) const noexcept {
+		details::prefetch(&items[location_of(indirection[entry_of(iLink)])]);
+	}
+	/**!
+	 * Entry is live and, with generations, of the same generation as the
+	 * link value iLink
+	 */
+	static inline bool is_live(size_type iEntry, size_type iLink) noexcept {
+		return (iEntry & (constants::k_invalid_bit | k_generation_mask)) ==
+		       (iLink & k_generation_mask);
+	}
+	/**!
+	 * Free entry linking to iNext, with generations it carries iEntry's
+	 * generation bumped and ends the free list with k_index_mask
+	 */
+	static inline size_type free_entry(size_type iEntry,
+	                                   size_type iNext) noexcept {
+		if constexpr (k_generational) {
+			size_type generation =
+			    ((iEntry >> constants::k_spoiler_shift) + 1) &
+			    constants::k_spoiler_max;
+			return static_cast<size_type>(
+			    constants::k_invalid_bit |
+			    (generation << constants::k_spoiler_shift) |
+			    (iNext == constants::k_null
+			         ? static_cast<size_type>(constants::k_index_mask)
+			         : iNext));
+		} else {
+			return iNext | constants::k_invalid_bit;
+		}
+	}
+	/**!
+	 * Generational links carry the entry in the k_index_mask bits only, the
+	 * table takes no entry past them
+	 */
+	inline bool out_of_links() const noexcept {
+		return k_generational && first_free_index == constants::k_null &&
+		       indirection.size() >= constants::k_index_mask;
+	}
+	static inline size_type next_free(size_type iEntry) noexcept {
+		if constexpr (k_generational) {
+			size_type next = iEntry & constants::k_index_mask;
+			return next == constants::k_index_mask
+			           ? static_cast<size_type>(constants::k_null)
+			           : next;
+		} else {
+			return iEntry & constants::k_link_mask;
+		}
+	}
+
 	inline link do_insert(SizeType iLoc) {
-		SizeType index = first_free_index;
+		SizeType index      = first_free_index;
+		SizeType generation = 0;
 		if (index == constants::k_null) {
 			index = static_cast<SizeType>(indirection.size());
 			indirection.emplace_back(iLoc);
@@ -184,16 +489,28 @@ private:
 			spoilers.emplace_back(0);
 #endif
 		} else {
-			first_free_index   = indirection[index] & constants::k_link_mask;
-			indirection[index] = iLoc;
+			first_free_index   = next_free(indirection[index]);
+			generation         = indirection[index] & k_generation_mask;
+			indirection[index] = generation | iLoc;
 		}
+		if constexpr (k_reverse_map)
+			reverse_indirection.push_back(index);
 #ifdef CPPTABLES_DEBUG
 		index = index_t(index, spoilers[index]).value();
 #endif
+		index |= generation;
 		Backref::template set_link<Ty, SizeType>(items[iLoc], link(index));
 		return link(index);
 	}
 
+	template <typename Lambda, typename Type>
+	inline static void for_each_run(Type& iCont, SizeType iBegin, SizeType iEnd,
+	                                Lambda&& iLambda) {
+		// items are always dense, the whole range is a single run
+		if (iBegin < iEnd)
+			std::forward<Lambda>(iLambda)(
+			    std::span(iCont.items.data() + iBegin, iEnd - iBegin));
+	}
 	template <typename Lambda, typename Type>
 	inline static void for_each(Type& iCont, Lambda&& iLambda) {
 		SizeType begin = 0;
@@ -213,7 +530,11 @@ private:
 	}
 
 	vector_t items;
+	// cold part of items[i] at the same position, only filled when k_cold
+	[[no_unique_address]] cold_vector_t<Cold, Allocator> cold_items;
 	std::vector<size_type> indirection;
+	// link slot of each item, only filled when k_reverse_map
+	std::vector<size_type> reverse_indirection;
 #ifdef CPPTABLES_DEBUG
 	std::vector<std::uint8_t> spoilers;
 #endif
@@ -0,0 +1,113 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace cpptables {
+
+/**!
+ * Storage policy for the sparse tables, slots live in pages of
+ * 1 << PageShift slots reached through a page directory. Growing only adds
+ * pages so objects never move and references stay valid until erased.
+ * PageShift 0 sizes pages to about 16KB.
+ */
+template <unsigned PageShift = 0> struct paged {
+	enum : unsigned { page_shift = PageShift };
+};
+
+namespace details {
+
+template <typename Ty, typename Storage> struct page_traits {
+	enum : unsigned { paged = 0, shift = 0 };
+};
+
+/**!
+ * Pages hold at least 64 slots so page boundaries fall on bitmap word
+ * boundaries
+ */
+template <typename Ty, unsigned PageShift>
+struct page_traits<Ty, paged<PageShift>> {
+	static constexpr unsigned k_auto =
+	    std::bit_width(std::max<std::size_t>(16384 / sizeof(Ty), 1)) - 1;
+	enum : unsigned {
+		paged = 1,
+		shift = std::clamp<unsigned>(PageShift ? PageShift : k_auto, 6, 20)
+	};
+};
+
+template <typename Storage>
+constexpr bool is_paged_v = page_traits<char, Storage>::paged != 0;
+
+/**!
+ * Fixed size pages of Block plus the directory pointing at them, slot i is
+ * pages_[i >> PageShift][i & mask]
+ */
+template <typename Block, typename SizeType, unsigned PageShift>
+class page_directory {
+public:
+	enum : std::size_t {
+		k_page_shift = PageShift,
+		k_page_size  = std::size_t(1) << PageShift,
+		k_page_mask  = k_page_size - 1
+	};
+
+	inline Block& operator[](SizeType iIndex) const noexcept {
+		return pages_[iIndex >> k_page_shift][iIndex & k_page_mask];
+	}
+
+	SizeType capacity() const noexcept {
+		return static_cast<SizeType>(pages_.size() << k_page_shift);
+	}
+
+	/**! First slot past the page holding iIndex */
+	static SizeType page_end(SizeType iIndex) noexcept {
+		return static_cast<SizeType>(
+		    (static_cast<std::size_t>(iIndex) | k_page_mask) + 1);
+	}
+
+	/**! Add pages until iSlots slots fit, existing pages are left in place */
+	template <typename Allocator>
+	void reserve(Allocator& iAllocator, SizeType iSlots) {
+		while (capacity() < iSlots)
+			pages_.push_back(
+			    reinterpret_cast<Block*>(iAllocator.allocate(k_page_size)));
+	}
+
+	/**! Release the pages no slot below iSlots lives in */
+	template <typename Allocator>
+	void shrink(Allocator& iAllocator, SizeType iSlots) {
+		using pointer     = typename std::allocator_traits<Allocator>::pointer;
+		std::size_t keep = (static_cast<std::size_t>(iSlots) + k_page_mask) >>
+		                   k_page_shift;
+		while (pages_.size() > keep) {
+			iAllocator.deallocate(reinterpret_cast<pointer>(pages_.back()),
+			                      k_page_size);
+			pages_.pop_back();
+		}
+	}
+
+	template <typename Allocator> void deallocate(Allocator& iAllocator) {
+		using pointer = typename std::allocator_traits<Allocator>::pointer;
+		for (auto page : pages_)
+			iAllocator.deallocate(reinterpret_cast<pointer>(page), k_page_size);
+		pages_.clear();
+	}
+
+private:
+	std::vector<Block*> pages_;
+};
+
+/**! Pointer to one contiguous array, or a page_directory for paged storage */
+template <typename Block, typename SizeType, typename Ty, typename Storage>
+using item_storage_t =
+    std::conditional_t<is_paged_v<Storage>,
+                       page_directory<Block, SizeType,
+                                      page_traits<Ty, Storage>::shift>,
+                       Block*>;
+
+} // namespace details
+} // namespace cpptables
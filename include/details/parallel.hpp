@@ -0,0 +1,89 @@
+#pragma once
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace cpptables {
+namespace details {
+
+enum : std::uint32_t {
+	// chunk boundaries are multiples of 64 slots, which keeps them on bitmap
+	// word and cache line boundaries
+	k_parallel_grain    = 64,
+	k_blocks_per_worker = 16,
+	k_tasks_per_worker  = 4
+};
+
+/**!
+ * Split [0, range()) into about iTasks chunks holding the same number of
+ * live objects. Live counts are gathered per block on the executor first.
+ * Returns the chunk boundaries, first is 0 and last is range().
+ */
+template <typename Table, typename Executor>
+std::vector<typename Table::size_type> partition_by_live(Table& iTable,
+                                                         Executor& iExec,
+                                                         std::size_t iTasks) {
+	using size_type = typename Table::size_type;
+	std::vector<size_type> bounds;
+	bounds.push_back(0);
+	size_type range = iTable.range();
+	if (!range)
+		return bounds;
+
+	std::size_t grains = (static_cast<std::size_t>(range) + k_parallel_grain - 1) /
+	                     k_parallel_grain;
+	std::size_t blocks = std::clamp<std::size_t>(
+	    iExec.concurrency() * k_blocks_per_worker, 1, grains);
+	std::size_t block_size =
+	    ((grains + blocks - 1) / blocks) * k_parallel_grain;
+	blocks = (static_cast<std::size_t>(range) + block_size - 1) / block_size;
+
+	auto block_end = [&](std::size_t iBlock) {
+		return static_cast<size_type>(std::min<std::size_t>(
+		    (iBlock + 1) * block_size, static_cast<std::size_t>(range)));
+	};
+	std::vector<size_type> live(blocks);
+	iExec.execute(blocks, [&](std::size_t iBlock) {
+		live[iBlock] = iTable.live_count(
+		    static_cast<size_type>(iBlock * block_size), block_end(iBlock));
+	});
+
+	std::size_t total = 0;
+	for (auto l : live)
+		total += l;
+	if (!total) {
+		bounds.push_back(range);
+		return bounds;
+	}
+	std::size_t tasks  = std::clamp<std::size_t>(iTasks, 1, blocks);
+	std::size_t filled = 0;
+	std::size_t next   = 1;
+	for (std::size_t b = 0; b + 1 < blocks; ++b) {
+		filled += live[b];
+		if (filled * tasks >= total * next) {
+			bounds.push_back(block_end(b));
+			while (filled * tasks >= total * next)
+				++next;
+		}
+	}
+	bounds.push_back(range);
+	return bounds;
+}
+
+/**!
+ * Run iLambda on every live object of iTable, chunks are balanced by live
+ * count and handed to iExec. iLambda gets Ty&, Ty const& on a const table,
+ * and must be safe to call concurrently. The tables forward their
+ * parallel_for_each here, on the default thread pool when given no executor.
+ */
+template <typename Table, typename Executor, typename Lambda>
+void parallel_for_each(Table& iTable, Executor& iExec, Lambda&& iLambda) {
+	auto bounds = partition_by_live(iTable, iExec,
+	                                iExec.concurrency() * k_tasks_per_worker);
+	iExec.execute(bounds.size() - 1, [&](std::size_t iTask) {
+		iTable.for_each(bounds[iTask], bounds[iTask + 1], iLambda);
+	});
+}
+
+} // namespace details
+} // namespace cpptables
@@ -6,15 +6,22 @@
  */
 
 #pragma once
+#include "growth_policy.hpp"
+#include <cassert>
 #include <cstdint>
 #include <memory>
 #include <type_traits>
 #include <cstring>
+
+#ifndef L_ASSERT
+#define L_ASSERT(expr) assert(expr)
+#endif
 // refer to:
 // https://en.cppreference.com/w/cpp/header/vector
 namespace cpptables {
 template <typename Ty, typename Allocator = std::allocator<Ty>,
-          typename SizeTy = std::uint32_t>
+          typename SizeTy = std::uint32_t,
+          typename Growth = growth_policy_t<Ty>>
 class podvector : public Allocator {
 	static_assert(std::is_trivially_copyable_v<Ty>,
 	              "Requires trivially copyable on Ty");
@@ -61,7 +68,7 @@ public:
 	    : Allocator(alloc) {
 		construct_from_range(first, last, std::is_integral<InputIterator>());
 	}
-	podvector(const podvector<Ty, Allocator>& x)
+	podvector(const podvector& x)
 
 	    : data_(allocate(x.capacity_)), size_(x.size_), capacity_(x.capacity_) {
 		copy(std::begin(x), std::end(x), data_);
@@ -88,10 +95,10 @@ public:
 	}
 
 	~podvector() { deallocate(); }
-	podvector<Ty, Allocator>& operator=(const podvector<Ty, Allocator>& x) {
+	podvector& operator=(const podvector& x) {
 		return assign_copy(x, propagate_allocator_on_copy());
 	}
-	podvector<Ty, Allocator>& operator=(podvector<Ty, Allocator>&& x) {
+	podvector& operator=(podvector&& x) {
 		return assign_move(std::move(x), propagate_allocator_on_move());
 	}
 	podvector& operator=(std::initializer_list<Ty> x) {
@@ -220,17 +227,17 @@ public:
 	// modifiers:
 	template <class... Args> void emplace_back(Args&&... args) {
 		if (capacity_ < size_ + 1)
-			unchecked_reserve(size_ + std::max<size_type>(size_ >> 1, 1));
+			unchecked_reserve(Growth::grow(size_, size_ + 1, sizeof(Ty)));
 		data_[size_++] = Ty(std::forward<Args>(args)...);
 	}
 	void push_back(const Ty& x) {
 		if (capacity_ < size_ + 1)
-			unchecked_reserve(size_ + std::max<size_type>(size_ >> 1, 1));
+			unchecked_reserve(Growth::grow(size_, size_ + 1, sizeof(Ty)));
 		data_[size_++] = x;
 	}
 	void push_back(Ty&& x) {
 		if (capacity_ < size_ + 1)
-			unchecked_reserve(size_ + std::max<size_type>(size_ >> 1, 1));
+			unchecked_reserve(Growth::grow(size_, size_ + 1, sizeof(Ty)));
 		data_[size_++] = std::move(x);
 	}
 	void pop_back() {
@@ -279,15 +286,15 @@ public:
 		return const_cast<iterator>(position);
 	}
 	iterator erase(const_iterator first, const_iterator last) {
-		L_ASSERT(last < end());
+		L_ASSERT(last <= end());
 		std::uint32_t n = static_cast<std::uint32_t>(std::distance(first, last));
 		std::memmove(const_cast<iterator>(first), last,
-		             reinterpret_cast<size_t>((data_ + size_) - (last)) *
+		             static_cast<size_t>((data_ + size_) - (last)) *
 		                 sizeof(Ty));
 		size_ -= n;
 		return const_cast<iterator>(first);
 	}
-	void swap(podvector<Ty, Allocator>& x) {
+	void swap(podvector& x) {
 		swap(x, propagate_allocator_on_swap());
 	}
 	void clear() noexcept { size_ = 0; }
@@ -297,7 +304,7 @@ private:
 		size_type p   = static_cast<size_type>(std::distance<const Ty*>(data_, it));
 		size_type nsz = size_ + n;
 		if (capacity_ < nsz) {
-			unchecked_reserve(size_ + std::max(size_ >> 1, n), p, n);
+			unchecked_reserve(Growth::grow(size_, nsz, sizeof(Ty)), p, n);
 		} else {
 			pointer src = const_cast<iterator>(it);
 			std::memmove(src + n, src, (size_ - p) * sizeof(Ty));
@@ -389,51 +396,45 @@ private:
 		data_     = d;
 		capacity_ = n;
 	}
-	void swap(podvector<Ty, Allocator>& x, std::false_type) {
+	void swap(podvector& x, std::false_type) {
 		std::swap(capacity_, x.capacity_);
 		std::swap(size_, x.size_);
 		std::swap(data_, x.data_);
 	}
-	void swap(podvector<Ty, Allocator>& x, std::true_type) {
+	void swap(podvector& x, std::true_type) {
 		std::swap(capacity_, x.capacity_);
 		std::swap(size_, x.size_);
 		std::swap(data_, x.data_);
 		std::swap<Allocator>(this, x);
 	}
 
-	friend void swap(podvector<Ty, Allocator>& lhs,
-	                 podvector<Ty, Allocator>& rhs) {
+	friend void swap(podvector& lhs, podvector& rhs) {
 		lhs.swap(rhs);
 	}
 
-	friend bool operator==(const podvector<Ty, Allocator>& x,
-	                       const podvector<Ty, Allocator>& y) {
-		return x.size_ == y.size_ && std::memcmp(x.data_, y.data_, x.size_) == 0;
+	friend bool operator==(const podvector& x, const podvector& y) {
+		return x.size_ == y.size_ &&
+		       std::memcmp(x.data_, y.data_, x.size_ * sizeof(Ty)) == 0;
 	}
 
-	friend bool operator<(const podvector<Ty, Allocator>& x,
-	                      const podvector<Ty, Allocator>& y) {
+	friend bool operator<(const podvector& x, const podvector& y) {
 		return std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end());
 	}
 
-	friend bool operator!=(const podvector<Ty, Allocator>& x,
-	                       const podvector<Ty, Allocator>& y) {
+	friend bool operator!=(const podvector& x, const podvector& y) {
 		return !(x == y);
 	}
 
-	friend bool operator>(const podvector<Ty, Allocator>& x,
-	                      const podvector<Ty, Allocator>& y) {
+	friend bool operator>(const podvector& x, const podvector& y) {
 		return std::lexicographical_compare(y.begin(), y.end(), x.begin(), x.end());
 	}
 
-	friend bool operator>=(const podvector<Ty, Allocator>& x,
-	                       const podvector<Ty, Allocator>& y) {
+	friend bool operator>=(const podvector& x, const podvector& y) {
 		return !std::lexicographical_compare(x.begin(), x.end(), y.begin(),
 		                                     y.end());
 	}
 
-	friend bool operator<=(const podvector<Ty, Allocator>& x,
-	                       const podvector<Ty, Allocator>& y) {
+	friend bool operator<=(const podvector& x, const podvector& y) {
 		return !std::lexicographical_compare(y.begin(), y.end(), x.begin(),
 		                                     x.end());
 	}
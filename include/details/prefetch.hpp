@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace cpptables {
+
+/**!
+ * Number of links for_each_link and gather look ahead by default. About as
+ * many misses as a core keeps in flight, raise it for slower memory.
+ */
+enum : std::size_t { k_prefetch_distance = 8 };
+
+namespace details {
+
+/**! Hint the cache line holding iAddress into cache, never faults */
+inline void prefetch(void const* iAddress) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(iAddress);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_prefetch(static_cast<char const*>(iAddress), _MM_HINT_T0);
+#else
+	(void)iAddress;
+#endif
+}
+
+/**!
+ * Visit iLinks in order, calling iPrefetch on the link Distance places
+ * ahead so the misses of consecutive lookups overlap
+ */
+template <std::size_t Distance, typename Link, typename Prefetch,
+          typename Visit>
+inline void prefetched_walk(std::span<Link const> iLinks,
+                            Prefetch&& iPrefetch, Visit&& iVisit) {
+	std::size_t n    = iLinks.size();
+	std::size_t head = Distance < n ? Distance : n;
+	for (std::size_t i = 0; i < head; ++i)
+		iPrefetch(iLinks[i]);
+	for (std::size_t i = 0; i < n; ++i) {
+		if (i + Distance < n)
+			iPrefetch(iLinks[i + Distance]);
+		iVisit(iLinks[i]);
+	}
+}
+
+/**!
+ * prefetched_walk for lookups going through one indirection: iFirst is
+ * called 2 * Distance links ahead and should prefetch the indirection entry,
+ * iSecond Distance links ahead reads it and prefetches the object.
+ */
+template <std::size_t Distance, typename Link, typename First,
+          typename Second, typename Visit>
+inline void prefetched_walk(std::span<Link const> iLinks, First&& iFirst,
+                            Second&& iSecond, Visit&& iVisit) {
+	std::size_t n = iLinks.size();
+	for (std::size_t i = 0, e = 2 * Distance < n ? 2 * Distance : n; i < e;
+	     ++i)
+		iFirst(iLinks[i]);
+	for (std::size_t i = 0, e = Distance < n ? Distance : n; i < e; ++i)
+		iSecond(iLinks[i]);
+	for (std::size_t i = 0; i < n; ++i) {
+		if (i + 2 * Distance < n)
+			iFirst(iLinks[i + 2 * Distance]);
+		if (i + Distance < n)
+			iSecond(iLinks[i + Distance]);
+		iVisit(iLinks[i]);
+	}
+}
+
+} // namespace details
+} // namespace cpptables
@@ -0,0 +1,490 @@
+#pragma once
+#include "basic_types.hpp"
+#include "bitmap_walk.hpp"
+#include "growth_policy.hpp"
+#include "parallel.hpp"
+#include "prefetch.hpp"
+#include <bit>
+#include <cstring>
+#include <span>
+#include <tuple>
+#include <vector>
+
+namespace cpptables {
+namespace details {
+
+/**!
+ * Struct of arrays table, every column lives in its own cache line aligned
+ * array and a slot is the same index in all of them. Links, slot reuse and
+ * the usage bitmap (bit set = free, slots past the map are valid) follow
+ * sparse_table_with_validmap, the lowest free slot is reused first.
+ *
+ * Ty only types the links, tables of Ty addressed by the same link can
+ * hold its hot members here.
+ */
+template <typename Ty, typename SizeType, typename Allocator,
+          typename... Columns>
+class soa_table : Allocator {
+	static_assert(sizeof...(Columns) > 0, "Need at least one column");
+
+	enum : std::size_t { k_line_size = 64 };
+	struct alignas(k_line_size) line {
+		std::byte bytes[k_line_size];
+	};
+	using line_allocator =
+	    typename std::allocator_traits<Allocator>::template rebind_alloc<line>;
+	using growth = growth_policy_t<Ty>;
+
+public:
+	using value_type = Ty;
+	using size_type  = SizeType;
+	using this_type  = soa_table<Ty, SizeType, Allocator, Columns...>;
+	using link       = cpptables::link<Ty, SizeType>;
+	using constants  = details::constants<SizeType>;
+	using index_t    = details::index_t<SizeType>;
+	using usage_word = std::uint64_t;
+	using usage_map  = std::vector<usage_word>;
+	using columns    = std::tuple<Columns...>;
+	template <std::size_t I>
+	using column_type = std::tuple_element_t<I, columns>;
+
+	enum : std::uint32_t { k_usage_shift = 6, k_usage_mask = 63 };
+	static constexpr usage_word k_usage_all  = ~usage_word(0);
+	static constexpr std::size_t k_columns   = sizeof...(Columns);
+	static constexpr std::size_t k_row_bytes = (sizeof(Columns) + ...);
+
+	soa_table() = default;
+	soa_table(soa_table const&) = delete;
+	soa_table& operator=(soa_table const&) = delete;
+	~soa_table() {
+		clear();
+		release(capacity_);
+	}
+
+	/**!
+	 * Lambda called for each live row, Lambda should accept Columns&...
+	 */
+	template <typename Lambda> void for_each(Lambda&& iLambda) {
+		this_type::for_each(*this, 0, size_, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for each live row, Lambda should accept Columns const&...
+	 */
+	template <typename Lambda> void for_each(Lambda&& iLambda) const {
+		this_type::for_each(*this, 0, size_, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for each live row, Lambda should accept Columns&...
+	 */
+	template <typename Lambda>
+	void for_each(size_type iBeg, size_type iEnd, Lambda&& iLambda) {
+		this_type::for_each(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for each live row, Lambda should accept Columns const&...
+	 */
+	template <typename Lambda>
+	void for_each(size_type iBeg, size_type iEnd, Lambda&& iLambda) const {
+		this_type::for_each(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for each maximal run of live rows, Lambda should accept
+	 * (size_type first_slot, std::span<Columns>...), one span per column
+	 */
+	template <typename Lambda> void for_each_run(Lambda&& iLambda) {
+		this_type::for_each_run(*this, 0, size_, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for each maximal run of live rows, Lambda should accept
+	 * (size_type first_slot, std::span<Columns const>...)
+	 */
+	template <typename Lambda> void for_each_run(Lambda&& iLambda) const {
+		this_type::for_each_run(*this, 0, size_, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for each maximal run of live rows within [iBeg, iEnd)
+	 */
+	template <typename Lambda>
+	void for_each_run(size_type iBeg, size_type iEnd, Lambda&& iLambda) {
+		this_type::for_each_run(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for each maximal run of live rows within [iBeg, iEnd)
+	 */
+	template <typename Lambda>
+	void for_each_run(size_type iBeg, size_type iEnd, Lambda&& iLambda) const {
+		this_type::for_each_run(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
+	/**! details::parallel_for_each on iExec, Lambda takes a row as for_each */
+	template <typename Executor, typename Lambda>
+	void parallel_for_each(Executor& iExec, Lambda&& iLambda) {
+		details::parallel_for_each(*this, iExec, std::forward<Lambda>(iLambda));
+	}
+	template <typename Executor, typename Lambda>
+	void parallel_for_each(Executor& iExec, Lambda&& iLambda) const {
+		details::parallel_for_each(*this, iExec, std::forward<Lambda>(iLambda));
+	}
+
+	/**! Total number of objects stored in the table */
+	size_type size() const noexcept { return valid_count_; }
+	/**! Total number of slots valid in the table */
+	size_type capacity() const noexcept { return capacity_; }
+	/**! Total number of slots to effieiencyl do parallel iteration */
+	size_type range() const noexcept { return size_; }
+	/**! Number of live objects in slots [iBeg, iEnd) */
+	size_type live_count(size_type iBeg, size_type iEnd) const {
+		if (iBeg >= iEnd)
+			return 0;
+		return iEnd - iBeg - details::count_free<size_type>(usage_, iBeg, iEnd);
+	}
+	/**! Slot iIndex holds a row, column spans have garbage in free slots */
+	bool is_valid(size_type iIndex) const noexcept {
+		size_type w = iIndex >> k_usage_shift;
+		return w >= usage_.size() ||
+		       (usage_[w] & (usage_word(1) << (iIndex & k_usage_mask))) == 0;
+	}
+
+	/**! Insert a row, one value per column */
+	link insert(Columns const&... iValues) {
+		size_type index = acquire();
+		construct(index, std::index_sequence_for<Columns...>(), iValues...);
+		return make_link(index);
+	}
+
+	void erase(link iIndex) {
+		size_type id = iIndex.value();
+#ifdef CPPTABLES_DEBUG
+		index_t index(id);
+		id = index.index();
+		assert(spoilers[id] == index.spoiler());
+		spoilers[id] = (spoilers[id] + 1) & constants::k_spoiler_max;
+#endif
+		destroy(id, std::index_sequence_for<Columns...>());
+		size_type w = id >> k_usage_shift;
+		if (w >= usage_.size())
+			usage_.resize(w + 1, 0);
+		usage_[w] |= usage_word(1) << (id & k_usage_mask);
+		if (id < first_free_index_)
+			first_free_index_ = id;
+		valid_count_--;
+	}
+
+	/**! Value of column I for the row at iIndex */
+	template <std::size_t I> column_type<I>& get(link iIndex) {
+		return std::get<I>(data_)[to_slot(iIndex)];
+	}
+	/**! Value of column I for the row at iIndex */
+	template <std::size_t I> column_type<I> const& get(link iIndex) const {
+		return std::get<I>(data_)[to_slot(iIndex)];
+	}
+	/**! Every column of the row at iIndex */
+	std::tuple<Columns&...> at(link iIndex) {
+		return row(to_slot(iIndex), std::index_sequence_for<Columns...>());
+	}
+	/**! Every column of the row at iIndex */
+	std::tuple<Columns const&...> at(link iIndex) const {
+		return row(to_slot(iIndex), std::index_sequence_for<Columns...>());
+	}
+	/**!
+	 * Lambda called with the row of each link in iLinks, in order, Lambda
+	 * should accept Columns&.... The row is prefetched in every column
+	 * Distance links ahead.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) {
+		details::prefetched_walk<Distance>(
+		    iLinks, [this](link iLink) { prefetch_link(iLink); },
+		    [&](link iLink) { std::apply(iLambda, at(iLink)); });
+	}
+	/**! Lambda called with the row of each link in iLinks, in order */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) const {
+		details::prefetched_walk<Distance>(
+		    iLinks, [this](link iLink) { prefetch_link(iLink); },
+		    [&](link iLink) { std::apply(iLambda, at(iLink)); });
+	}
+	/**!
+	 * Copy the rows of iLinks to oOutput as std::tuple<Columns...>, in
+	 * order. Returns the iterator past the last copy.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename OutputIt>
+	OutputIt gather(std::span<link const> iLinks, OutputIt oOutput) const {
+		details::prefetched_walk<Distance>(
+		    iLinks, [this](link iLink) { prefetch_link(iLink); },
+		    [&](link iLink) { *oOutput++ = columns(at(iLink)); });
+		return oOutput;
+	}
+
+	/**!
+	 * Column I over [0, range()), the array is 64 byte aligned. Free slots
+	 * hold no object, check is_valid or use for_each_run.
+	 */
+	template <std::size_t I> std::span<column_type<I>> column() noexcept {
+		return std::span(std::get<I>(data_), size_);
+	}
+	/**! Column I over [0, range()) */
+	template <std::size_t I>
+	std::span<column_type<I> const> column() const noexcept {
+		return std::span<column_type<I> const>(std::get<I>(data_), size_);
+	}
+
+	void clear() {
+		if constexpr (!(std::is_trivially_destructible_v<Columns> && ...)) {
+			auto destroy_row = [&](size_type i) {
+				destroy(i, std::index_sequence_for<Columns...>());
+			};
+			details::for_each_live(usage_, size_type(0), size_,
+			                       details::scan_words<size_type>{usage_},
+			                       destroy_row);
+		}
+		usage_.clear();
+		size_        = 0;
+		valid_count_ = 0;
+#ifdef CPPTABLES_DEBUG
+		spoilers.clear();
+#endif
+		first_free_index_ = constants::k_null;
+	}
+
+private:
+	inline size_type to_slot(link iIndex) const {
+		size_type id = iIndex.value();
+#ifdef CPPTABLES_DEBUG
+		index_t index(id);
+		id = index.index();
+		assert(spoilers[id] == index.spoiler());
+#endif
+		return id;
+	}
+	/**! Prefetch the row of iLink in every column, the link is not checked */
+	inline void prefetch_link(link iLink) const noexcept {
+		size_type id = index_t(iLink.value()).index();
+		std::apply([&](auto*... iColumns) { (details::prefetch(iColumns + id), ...); },
+		           data_);
+	}
+	inline link make_link(size_type iIndex) const {
+#ifdef CPPTABLES_DEBUG
+		return link(index_t(iIndex, spoilers[iIndex]).value());
+#else
+		return link(iIndex);
+#endif
+	}
+
+	/**! Lowest free slot, or a new one at the end */
+	size_type acquire() {
+		size_type index = first_free_index_;
+		if (index != constants::k_null) {
+			usage_[index >> k_usage_shift] &=
+			    ~(usage_word(1) << (index & k_usage_mask));
+			first_free_index_ = details::next_free(usage_, index + 1);
+		} else {
+			if (capacity_ < size_ + 1)
+				grow(growth::grow(size_, size_ + 1, k_row_bytes));
+			index = size_++;
+#ifdef CPPTABLES_DEBUG
+			spoilers.emplace_back(0);
+#endif
+		}
+		valid_count_++;
+		return index;
+	}
+
+	template <std::size_t... Is>
+	void construct(size_type iIndex, std::index_sequence<Is...>,
+	               Columns const&... iValues) {
+		(::new (static_cast<void*>(std::get<Is>(data_) + iIndex))
+		     Columns(iValues),
+		 ...);
+	}
+	template <std::size_t... Is>
+	void destroy(size_type iIndex, std::index_sequence<Is...>) {
+		(std::get<Is>(data_)[iIndex].~Columns(), ...);
+	}
+	template <std::size_t... Is>
+	std::tuple<Columns&...> row(size_type iIndex, std::index_sequence<Is...>) {
+		return {std::get<Is>(data_)[iIndex]...};
+	}
+	template <std::size_t... Is>
+	std::tuple<Columns const&...> row(size_type iIndex,
+	                                  std::index_sequence<Is...>) const {
+		return {std::get<Is>(data_)[iIndex]...};
+	}
+
+	template <typename Lambda, typename Type>
+	inline static void for_each_run(Type& iCont, size_type iBegin,
+	                                size_type iEnd, Lambda&& iLambda) {
+		details::for_each_live_run(
+		    iCont.usage_, iBegin, std::min(iEnd, iCont.size_),
+		    details::scan_words<size_type>{iCont.usage_},
+		    [&](size_type iFirst, size_type iLast) {
+			    std::apply(
+			        [&](auto*... iColumns) {
+				        std::forward<Lambda>(iLambda)(
+				            iFirst, std::span(iColumns + iFirst, iLast - iFirst)...);
+			        },
+			        iCont.data_);
+		    });
+	}
+	template <typename Lambda, typename Type>
+	inline static void for_each(Type& iCont, size_type iBegin, size_type iEnd,
+	                            Lambda&& iLambda) {
+		for_each_run(iCont, iBegin, iEnd, [&](size_type, auto... iSpans) {
+			for (std::size_t k = 0, n = std::get<0>(std::tie(iSpans...)).size();
+			     k < n; ++k)
+				std::forward<Lambda>(iLambda)(iSpans[k]...);
+		});
+	}
+
+	template <typename Column> Column* allocate(size_type iSlots) {
+		line_allocator lines(*this);
+		return reinterpret_cast<Column*>(
+		    lines.allocate(lines_for<Column>(iSlots)));
+	}
+	template <typename Column>
+	void deallocate(Column* iData, size_type iSlots) {
+		if (!iData)
+			return;
+		line_allocator lines(*this);
+		lines.deallocate(reinterpret_cast<line*>(iData),
+		                 lines_for<Column>(iSlots));
+	}
+	template <typename Column>
+	static constexpr std::size_t lines_for(size_type iSlots) noexcept {
+		return (static_cast<std::size_t>(iSlots) * sizeof(Column) + k_line_size -
+		        1) /
+		       k_line_size;
+	}
+
+	/**! Reallocate every column to iCapacity slots, live values are moved */
+	void grow(size_type iCapacity) {
+		std::tuple<Columns*...> data{allocate<Columns>(iCapacity)...};
+		relocate(data, std::index_sequence_for<Columns...>());
+		release(capacity_);
+		data_     = data;
+		capacity_ = iCapacity;
+	}
+	template <std::size_t... Is>
+	void relocate(std::tuple<Columns*...>& oData, std::index_sequence<Is...>) {
+		(relocate_column(std::get<Is>(data_), std::get<Is>(oData)), ...);
+	}
+	template <typename Column> void relocate_column(Column* iFrom, Column* oTo) {
+		if (!size_)
+			return;
+		if constexpr (std::is_trivially_copyable_v<Column>) {
+			std::memcpy(static_cast<void*>(oTo), iFrom, size_ * sizeof(Column));
+		} else {
+			for (size_type i = 0; i < size_; ++i) {
+				if (is_valid(i)) {
+					::new (static_cast<void*>(oTo + i)) Column(std::move(iFrom[i]));
+					iFrom[i].~Column();
+				}
+			}
+		}
+	}
+	void release(size_type iSlots) {
+		std::apply([&](auto*... iColumns) { (deallocate(iColumns, iSlots), ...); },
+		           data_);
+		data_ = {};
+	}
+
+	std::tuple<Columns*...> data_ = {};
+	usage_map usage_;
+	size_type size_             = 0;
+	size_type capacity_         = 0;
+	size_type valid_count_      = 0;
+	size_type first_free_index_ = constants::k_null;
+#ifdef CPPTABLES_DEBUG
+	std::vector<std::uint8_t> spoilers;
+#endif
+};
+
+template <auto Member> struct member_traits;
+template <typename Owner, typename Field, Field Owner::*Member>
+struct member_traits<Member> {
+	using owner = Owner;
+	using type  = Field;
+};
+
+template <auto First, auto Second> constexpr bool is_same_member() {
+	if constexpr (std::is_same_v<decltype(First), decltype(Second)>)
+		return First == Second;
+	else
+		return false;
+}
+
+/**!
+ * soa_table whose columns are the listed members of Ty. Rows are inserted
+ * from a Ty and members are reached by member pointer.
+ */
+template <typename Ty, typename SizeType, typename Allocator, auto... Members>
+class soa_table_of
+    : public soa_table<Ty, SizeType, Allocator,
+                       typename member_traits<Members>::type...> {
+	using base_type = soa_table<Ty, SizeType, Allocator,
+	                            typename member_traits<Members>::type...>;
+
+	template <auto Member> static constexpr std::size_t find() {
+		std::size_t index = 0;
+		std::size_t found = sizeof...(Members);
+		((is_same_member<Members, Member>() ? (found = index, ++index)
+		                                    : ++index),
+		 ...);
+		return found;
+	}
+	template <auto Member> static constexpr std::size_t index_of() {
+		constexpr std::size_t index = find<Member>();
+		static_assert(index < sizeof...(Members),
+		              "Member is not a column of this table");
+		return index;
+	}
+
+public:
+	using link = typename base_type::link;
+	using base_type::insert;
+
+	/**! Insert the selected members of iObject as a row */
+	link insert(Ty const& iObject) {
+		return base_type::insert((iObject.*Members)...);
+	}
+	/**! Rebuild a Ty from a row, members without a column are defaulted */
+	Ty gather(link iIndex) const {
+		Ty object{};
+		auto row = base_type::at(iIndex);
+		std::apply([&](auto const&... iValues) { ((object.*Members = iValues), ...); },
+		           row);
+		return object;
+	}
+	/**!
+	 * Rebuild the objects of iLinks to oOutput in order, rows are prefetched
+	 * like soa_table::for_each_link
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename OutputIt>
+	OutputIt gather(std::span<link const> iLinks, OutputIt oOutput) const {
+		base_type::template for_each_link<Distance>(
+		    iLinks, [&](auto const&... iValues) {
+			    Ty object{};
+			    ((object.*Members = iValues), ...);
+			    *oOutput++ = std::move(object);
+		    });
+		return oOutput;
+	}
+	/**! Member of the row at iIndex */
+	template <auto Member> auto& get_member(link iIndex) {
+		return base_type::template get<index_of<Member>()>(iIndex);
+	}
+	/**! Member of the row at iIndex */
+	template <auto Member> auto const& get_member(link iIndex) const {
+		return base_type::template get<index_of<Member>()>(iIndex);
+	}
+	/**! Column holding Member, see soa_table::column */
+	template <auto Member> auto member_column() noexcept {
+		return base_type::template column<index_of<Member>()>();
+	}
+	/**! Column holding Member, see soa_table::column */
+	template <auto Member> auto member_column() const noexcept {
+		return base_type::template column<index_of<Member>()>();
+	}
+};
+
+} // namespace details
+} // namespace cpptables
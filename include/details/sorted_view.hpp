@@ -1,7 +1,10 @@
 #pragma once
 #include "basic_view.hpp"
 #include "constants.hpp"
+#include <algorithm>
 #include <functional>
+#include <iterator>
+#include <span>
 
 namespace cpptables {
 template <typename Container> class sorted_view : public basic_view<Container> {
@@ -35,7 +38,7 @@ public:
 		auto first = std::begin(base_type::items);
 		auto last  = std::end(base_type::items);
 		auto it    = std::lower_bound(first, last, (size_type)iCompIndex);
-		if (it != last) {
+		if (it != last && *it == (size_type)iCompIndex) {
 			base_type::items.erase(it);
 			return true;
 		}
@@ -45,12 +48,91 @@ public:
 		auto first = std::begin(base_type::items);
 		auto last  = std::end(base_type::items);
 		auto it    = std::lower_bound(first, last, (size_type)iCompIndex);
-		if (it != last)
+		if (it != last && *it == (size_type)iCompIndex)
 			return static_cast<size_type>(std::distance(first, it));
 		return details::constants<size_type>::k_null;
 	}
+	inline bool contains(link iCompIndex) const {
+		return find(iCompIndex) != details::constants<size_type>::k_null;
+	}
+
+	/**!
+	 * Insert a batch of links with one sort of the batch and one linear merge.
+	 * Links already in the view, or repeated in the batch, are added once.
+	 */
+	void insert_bulk(std::span<link const> iLinks) {
+		podvector<size_type> batch = sorted_batch(iLinks);
+		podvector<size_type> merged;
+		merged.reserve(
+		    static_cast<size_type>(base_type::items.size() + batch.size()));
+		std::set_union(base_type::items.begin(), base_type::items.end(),
+		               batch.begin(), batch.end(), std::back_inserter(merged));
+		base_type::items = std::move(merged);
+	}
+	/**!
+	 * Erase a batch of links with one sort of the batch and one in place
+	 * pass, links that are not members are ignored. Returns the number of
+	 * links erased.
+	 */
+	size_type erase_bulk(std::span<link const> iLinks) {
+		podvector<size_type> batch = sorted_batch(iLinks);
+		auto& items  = base_type::items;
+		auto removed = batch.begin();
+		size_type to = 0;
+		for (size_type from = 0, n = base_type::size(); from < n; ++from) {
+			while (removed != batch.end() && *removed < items[from])
+				++removed;
+			if (removed == batch.end() || *removed != items[from])
+				items[to++] = items[from];
+		}
+		size_type erased = base_type::size() - to;
+		items.resize(to);
+		return erased;
+	}
+
+	/**! Links in this view or iOther, both must view the same container */
+	sorted_view set_union(sorted_view const& iOther) const {
+		return combine(iOther, [](auto&&... iArgs) {
+			return std::set_union(std::forward<decltype(iArgs)>(iArgs)...);
+		});
+	}
+	/**! Links in this view and iOther, both must view the same container */
+	sorted_view set_intersection(sorted_view const& iOther) const {
+		return combine(iOther, [](auto&&... iArgs) {
+			return std::set_intersection(std::forward<decltype(iArgs)>(iArgs)...);
+		});
+	}
+	/**! Links in this view but not iOther, both must view the same container */
+	sorted_view set_difference(sorted_view const& iOther) const {
+		return combine(iOther, [](auto&&... iArgs) {
+			return std::set_difference(std::forward<decltype(iArgs)>(iArgs)...);
+		});
+	}
 
 protected:
+	static podvector<size_type> sorted_batch(std::span<link const> iLinks) {
+		podvector<size_type> batch;
+		batch.reserve(static_cast<size_type>(iLinks.size()));
+		for (auto l : iLinks)
+			batch.push_back(l.value());
+		std::sort(batch.begin(), batch.end());
+		batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+		return batch;
+	}
+
+	template <typename Operation>
+	sorted_view combine(sorted_view const& iOther,
+	                    Operation&& iOperation) const {
+		assert(&base_type::container.get() == &iOther.container.get());
+		auto const& first  = base_type::items;
+		auto const& second = iOther.items;
+		podvector<size_type> result;
+		result.reserve(static_cast<size_type>(first.size() + second.size()));
+		iOperation(first.begin(), first.end(), second.begin(), second.end(),
+		           std::back_inserter(result));
+		return sorted_view(base_type::container.get(), std::move(result));
+	}
+
 	static typename podvector<size_type>::iterator insert_sorted(
 	    podvector<size_type>& iVec, size_type iItem) {
 		return iVec.insert(std::upper_bound(iVec.begin(), iVec.end(), iItem),
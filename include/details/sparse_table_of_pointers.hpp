@@ -81,6 +81,37 @@ public:
 		return *this->base_type::at(link((SizeType)iIndex));
 	}
 	inline Ty& at(ulink iIndex) { return *this->base_type::at(link((SizeType)iIndex)); }
+	using base_type::for_each_link;
+	using base_type::gather;
+	/**!
+	 * Lambda called with the object of each link in iLinks, in order. Slots
+	 * are prefetched 2 * Distance links ahead and the objects they point to
+	 * Distance links ahead.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<ulink const> iLinks, Lambda&& iLambda) {
+		details::prefetched_walk<Distance>(
+		    iLinks,
+		    [this](ulink iLink) { this->prefetch_link(link((SizeType)iLink)); },
+		    [this](ulink iLink) {
+			    details::prefetch(this->base_type::at(link((SizeType)iLink)));
+		    },
+		    [&](ulink iLink) { iLambda(at(iLink)); });
+	}
+	/**! Lambda called with the object of each link in iLinks, in order */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<ulink const> iLinks, Lambda&& iLambda) const {
+		const_cast<sparse_table_of_pointers*>(this)
+		    ->template for_each_link<Distance>(
+		        iLinks, [&](Ty const& iObject) { iLambda(iObject); });
+	}
+	/**! Copy the objects of iLinks to oOutput, see for_each_link */
+	template <std::size_t Distance = k_prefetch_distance, typename OutputIt>
+	OutputIt gather(std::span<ulink const> iLinks, OutputIt oOutput) const {
+		for_each_link<Distance>(iLinks,
+		                        [&](Ty const& iObject) { *oOutput++ = iObject; });
+		return oOutput;
+	}
 };
 } // namespace details
 } // namespace cpptables
@@ -1,5 +1,10 @@
 #pragma once
+#include "link_remap.hpp"
+#include "parallel.hpp"
+#include "prefetch.hpp"
 #include "storage_with_backref.hpp"
+#include <algorithm>
+#include <span>
 #include <vector>
 
 namespace cpptables {
@@ -185,6 +190,41 @@ public:
 	void for_each(size_type iBeg, size_type iEnd, Lambda&& iLambda) const {
 		this_type::for_each(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
 	}
+	/**! details::parallel_for_each, on iExec or the default thread pool */
+	template <typename Executor, typename Lambda>
+	void parallel_for_each(Executor& iExec, Lambda&& iLambda) {
+		details::parallel_for_each(*this, iExec, std::forward<Lambda>(iLambda));
+	}
+	template <typename Executor, typename Lambda>
+	void parallel_for_each(Executor& iExec, Lambda&& iLambda) const {
+		details::parallel_for_each(*this, iExec, std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void parallel_for_each(Lambda&& iLambda) {
+		details::parallel_for_each(*this, default_thread_pool(),
+		                           std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void parallel_for_each(Lambda&& iLambda) const {
+		details::parallel_for_each(*this, default_thread_pool(),
+		                           std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called with a std::span<Ty>, std::span<Ty const> when const, for
+	 * each maximal run of contiguous live objects in [iBeg, iEnd) or range()
+	 */
+	template <typename Lambda> void for_each_run(Lambda&& iLambda) {
+		this_type::for_each_run(*this, 0, range(), std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void for_each_run(Lambda&& iLambda) const {
+		this_type::for_each_run(*this, 0, range(), std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda>
+	void for_each_run(size_type iBeg, size_type iEnd, Lambda&& iLambda) {
+		this_type::for_each_run(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda>
+	void for_each_run(size_type iBeg, size_type iEnd, Lambda&& iLambda) const {
+		this_type::for_each_run(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
 	/**! Total number of objects stored in the table */
 	size_type size() const noexcept {
 		return static_cast<size_type>(valid_count_);
@@ -195,6 +235,13 @@ public:
 	}
 	/**! Total number of slots to effieiencyl do parallel iteration */
 	size_type range() const noexcept { return capacity(); }
+	/**! Number of live objects in slots [iBeg, iEnd) */
+	size_type live_count(size_type iBeg, size_type iEnd) const {
+		size_type count = 0;
+		for (; iBeg < iEnd; ++iBeg)
+			count += items_[iBeg].is_null() ? 0 : 1;
+		return count;
+	}
 
 	inline link insert(Ty const& iObject) {
 		SizeType index = first_free_index_;
@@ -252,12 +299,13 @@ public:
 		index_t index(id);
 		id = index.index();
 		assert(spoilers_[id] == index.spoiler());
-		spoilers_[id] = (spoilers_[id] + 1) & 0x7f;
+		spoilers_[id] = (spoilers_[id] + 1) & constants::k_spoiler_max;
 #endif
 		items_[id].destroy();
 		items_[id].set_next_free_index(first_free_index_);
 		valid_count_--;
 		first_free_index_ = id;
+		compact_range_    = constants::k_null;
 	}
 
 	inline Ty& at(link iIndex) {
@@ -273,6 +321,38 @@ public:
 	inline const Ty& at(link iIndex) const {
 		return const_cast<const Ty&>(const_cast<this_type*>(this)->at(iIndex));
 	}
+	inline Ty& at_index(size_type iIndex) { return items_[iIndex].get(); }
+	inline const Ty& at_index(size_type iIndex) const {
+		return const_cast<const Ty&>(
+		    const_cast<this_type*>(this)->at_index(iIndex));
+	}
+	/**!
+	 * Lambda called with the object of each link in iLinks, in order.
+	 * Slots are prefetched Distance links ahead so the cache misses of random
+	 * lookups overlap.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) {
+		details::prefetched_walk<Distance>(
+		    iLinks, [this](link iLink) { prefetch_link(iLink); },
+		    [&](link iLink) { iLambda(at(iLink)); });
+	}
+	/**! Lambda called with the object of each link in iLinks, in order */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) const {
+		const_cast<this_type*>(this)->template for_each_link<Distance>(
+		    iLinks, [&](Ty const& iObject) { iLambda(iObject); });
+	}
+	/**!
+	 * Copy the objects of iLinks to oOutput in order, prefetching like
+	 * for_each_link. Returns the iterator past the last copy.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename OutputIt>
+	OutputIt gather(std::span<link const> iLinks, OutputIt oOutput) const {
+		for_each_link<Distance>(iLinks,
+		                        [&](Ty const& iObject) { *oOutput++ = iObject; });
+		return oOutput;
+	}
 
 	// Iterators
 	iterator begin() { return iterator(items_.begin(), items_.end()); }
@@ -310,9 +390,222 @@ public:
 		spoilers_.clear();
 #endif
 		first_free_index_ = constants::k_null;
+		compact_holes_    = {};
+		compact_lo_       = 0;
+	}
+
+	/**!
+	 * Move the live objects at the end of the table into the lowest free
+	 * slots until no hole is left, then release the tail storage. Backrefs
+	 * of moved objects are rewritten. Returns the links that changed.
+	 */
+	link_remap<link> compact() {
+		link_remap<link> remap;
+		compact_step(constants::k_null, remap);
+		return remap;
+	}
+	/**!
+	 * compact() spread over several calls, at most iBudget objects are moved.
+	 * oRemap receives the links changed by this step only, apply it before
+	 * the next erase. The first step after the free list changed sorts it,
+	 * later steps cost O(iBudget) plus the tail slots they release. Returns
+	 * true once no hole is left.
+	 */
+	bool compact_step(size_type iBudget, link_remap<link>& oRemap) {
+		oRemap.clear();
+		if (compact_head_ != first_free_index_ || compact_range_ != range())
+			sort_free_list();
+		size_type last = prev_live(range());
+		for (size_type moved = 0; compact_lo_ < compact_holes_.size() &&
+		                          last != constants::k_null && moved < iBudget;
+		     ++moved) {
+			size_type hole = compact_holes_[compact_lo_];
+			if (hole > last)
+				break;
+			move_slot(last, hole, oRemap);
+			compact_lo_++;
+			last = prev_live(last);
+		}
+		trim(last == constants::k_null ? 0 : last + 1);
+		oRemap.sort();
+		if (first_free_index_ != constants::k_null)
+			return false;
+		compact_holes_ = {};
+		compact_lo_    = 0;
+		items_.shrink_to_fit();
+#ifdef CPPTABLES_DEBUG
+		spoilers_.shrink_to_fit();
+#endif
+		return true;
+	}
+
+	/**!
+	 * Take iCount slots for deferred inserts and write their links to oLinks:
+	 * free slots first, then new slots appended with one resize. Reserved
+	 * slots stay empty and off the free list until emplace_at fills them or
+	 * release_links hands them back. Do not compact or clear meanwhile.
+	 */
+	template <typename OutputIt>
+	OutputIt reserve_links(size_type iCount, OutputIt oLinks) {
+		for (; iCount && first_free_index_ != constants::k_null; --iCount) {
+			size_type index   = first_free_index_;
+			first_free_index_ = items_[index].get_next_free_index();
+			items_[index].set_next_free_index(constants::k_null);
+			*oLinks++ = slot_link(index);
+		}
+		size_type begin = range();
+		items_.resize(begin + iCount);
+#ifdef CPPTABLES_DEBUG
+		spoilers_.resize(begin + iCount, 0);
+#endif
+		for (size_type i = 0; i < iCount; ++i) {
+			items_[begin + i].set_next_free_index(constants::k_null);
+			*oLinks++ = slot_link(begin + i);
+		}
+		return oLinks;
+	}
+	/**! Construct an object in the slot reserved for iIndex */
+	template <typename... Args> void emplace_at(link iIndex, Args&&... args) {
+		size_type id = slot_index(iIndex);
+		assert(items_[id].is_null() && "Slot is not reserved");
+		items_[id].construct(std::forward<Args>(args)...);
+		set_link(items_[id].get(), iIndex);
+		valid_count_++;
+	}
+	/**! Put reserved slots that were never filled back on the free list */
+	void release_links(std::span<link const> iLinks) {
+		size_type head = first_free_index_;
+		for (link l : iLinks) {
+			size_type id = slot_index(l);
+			assert(items_[id].is_null() && "Slot is not reserved");
+			items_[id].set_next_free_index(head);
+			head = id;
+		}
+		first_free_index_ = head;
+		compact_range_    = constants::k_null;
+	}
+	/**!
+	 * Erase every link of iLinks, slots are prefetched ahead and the free
+	 * list head is written once
+	 */
+	void erase_bulk(std::span<link const> iLinks) {
+		size_type head = first_free_index_;
+		details::prefetched_walk<k_prefetch_distance>(
+		    iLinks, [this](link iLink) { prefetch_link(iLink); },
+		    [&](link iLink) {
+			    size_type id = slot_index(iLink);
+#ifdef CPPTABLES_DEBUG
+			    spoilers_[id] = (spoilers_[id] + 1) & constants::k_spoiler_max;
+#endif
+			    items_[id].destroy();
+			    items_[id].set_next_free_index(head);
+			    head = id;
+		    });
+		valid_count_ -= static_cast<size_type>(iLinks.size());
+		first_free_index_ = head;
+		compact_range_    = constants::k_null;
+	}
+
+protected:
+	/**! Prefetch the slot of iLink, the link is not checked */
+	inline void prefetch_link(link iLink) const noexcept {
+		details::prefetch(&items_[index_t(iLink.value()).index()]);
 	}
 
 private:
+	/**! Slot of iLink, its spoiler is checked in debug builds */
+	inline size_type slot_index(link iLink) const {
+		index_t index(iLink.value());
+#ifdef CPPTABLES_DEBUG
+		assert(spoilers_[index.index()] == index.spoiler());
+#endif
+		return index.index();
+	}
+	inline link slot_link(size_type iIndex) const {
+#ifdef CPPTABLES_DEBUG
+		return link(index_t(iIndex, spoilers_[iIndex]).value());
+#else
+		return link(iIndex);
+#endif
+	}
+	/**! Last live slot before iIdx, k_null if there is none */
+	size_type prev_live(size_type iIdx) const {
+		while (iIdx > 0) {
+			if (!items_[--iIdx].is_null())
+				return iIdx;
+		}
+		return constants::k_null;
+	}
+	void move_slot(size_type iFrom, size_type iTo, link_remap<link>& oRemap) {
+		items_[iTo].construct(std::move(items_[iFrom].get()));
+		items_[iFrom].destroy();
+		items_[iFrom].set_next_free_index(constants::k_null);
+		link from(iFrom);
+		link to(iTo);
+#ifdef CPPTABLES_DEBUG
+		from = link(index_t(iFrom, spoilers_[iFrom]).value());
+		to   = link(index_t(iTo, spoilers_[iTo]).value());
+#endif
+		set_link(items_[iTo].get(), to);
+		oRemap.add(from, to);
+	}
+	/**!
+	 * Collect the free list in compact_holes_ and relink it in slot order,
+	 * so compaction fills the lowest hole by popping the head
+	 */
+	void sort_free_list() {
+		compact_holes_.clear();
+		compact_lo_ = 0;
+		for (size_type i = first_free_index_; i != constants::k_null;
+		     i          = items_[i].get_next_free_index())
+			compact_holes_.push_back(i);
+		std::sort(compact_holes_.begin(), compact_holes_.end());
+		for (std::size_t i = 0, n = compact_holes_.size(); i < n; ++i)
+			items_[compact_holes_[i]].set_next_free_index(
+			    i + 1 < n ? compact_holes_[i + 1] : constants::k_null);
+		first_free_index_ =
+		    compact_holes_.empty() ? constants::k_null : compact_holes_[0];
+	}
+	/**!
+	 * Drop the slots from iEnd on, all free, and cut the holes among them
+	 * off the end of the sorted free list
+	 */
+	void trim(size_type iEnd) {
+		while (compact_holes_.size() > compact_lo_ &&
+		       compact_holes_.back() >= iEnd)
+			compact_holes_.pop_back();
+		items_.resize(iEnd);
+#ifdef CPPTABLES_DEBUG
+		spoilers_.resize(iEnd);
+#endif
+		if (compact_lo_ < compact_holes_.size()) {
+			items_[compact_holes_.back()].set_next_free_index(constants::k_null);
+			first_free_index_ = compact_holes_[compact_lo_];
+		} else {
+			first_free_index_ = constants::k_null;
+		}
+		compact_head_  = first_free_index_;
+		compact_range_ = range();
+	}
+
+	template <typename Lambda, typename Type>
+	inline static void for_each_run(Type& iCont, SizeType iBegin, SizeType iEnd,
+	                                Lambda&& iLambda) {
+		static_assert(details::is_array_layout_v<storage, Ty>,
+		              "Runs need the slots laid out as an array of Ty");
+		SizeType begin = iBegin;
+		while (begin < iEnd) {
+			while (begin < iEnd && iCont.items_[begin].is_null())
+				++begin;
+			SizeType end = begin;
+			while (end < iEnd && !iCont.items_[end].is_null())
+				++end;
+			if (begin < end)
+				std::forward<Lambda>(iLambda)(
+				    std::span(&iCont.items_[begin].get(), end - begin));
+			begin = end;
+		}
+	}
 	template <typename Lambda, typename Type>
 	inline static void for_each(Type& iCont, Lambda&& iLambda) {
 		SizeType begin = 0;
@@ -339,6 +632,13 @@ private:
 #endif
 	size_type first_free_index_ = constants::k_null;
 	size_type valid_count_      = 0;
+	// compact_step state: free slots sorted, [compact_lo_, end) still free,
+	// valid while the free list head and range() are as the last step left.
+	// Erases reset compact_range_, they can bring that head back.
+	std::vector<size_type> compact_holes_;
+	std::size_t compact_lo_  = 0;
+	size_type compact_head_  = constants::k_null;
+	size_type compact_range_ = 0;
 };
 
 } // namespace details
@@ -1,5 +1,9 @@
 #pragma once
 #include "basic_types.hpp"
+#include "growth_policy.hpp"
+#include "paged_storage.hpp"
+#include "prefetch.hpp"
+#include <span>
 #include <vector>
 
 namespace cpptables {
@@ -8,7 +12,8 @@ namespace details {
 template <typename Ty, typename SizeType = std::uint32_t,
           typename Allocator = std::allocator<Ty>,
           typename Backref   = std::false_type,
-          typename Storage   = std::false_type>
+          typename Storage   = std::false_type,
+          typename Growth    = growth_policy_t<Ty>>
 class sparse_table_with_no_iter : Allocator {
 
 	static_assert(
@@ -47,12 +52,16 @@ class sparse_table_with_no_iter : Allocator {
 		void destroy() { object.~Ty(); }
 	};
 	using dbpointer = data_block*;
+	using item_storage =
+	    details::item_storage_t<data_block, SizeType, Ty, Storage>;
+	static constexpr bool k_paged = details::is_paged_v<Storage>;
 
 public:
 	using value_type = Ty;
 	using size_type  = SizeType;
 	using this_type =
-	    sparse_table_with_no_iter<Ty, SizeType, Allocator, Backref, Storage>;
+	    sparse_table_with_no_iter<Ty, SizeType, Allocator, Backref, Storage,
+	                              Growth>;
 	using link            = cpptables::link<Ty, SizeType>;
 	using constants       = details::constants<SizeType>;
 	using index_t         = details::index_t<SizeType>;
@@ -143,7 +152,7 @@ public:
 		index_t index(id);
 		id = index.index();
 		assert(spoilers[id] == index.spoiler());
-		spoilers[id] = (spoilers[id] + 1) & 0x7f;
+		spoilers[id] = (spoilers[id] + 1) & constants::k_spoiler_max;
 #endif
 		items_[id].destroy();
 		items_[id].set_integer(first_free_index_);
@@ -164,6 +173,33 @@ public:
 	inline Ty const& at(link iIndex) const {
 		return const_cast<Ty const&>(const_cast<this_type*>(this)->at(iIndex));
 	}
+	/**!
+	 * Lambda called with the object of each link in iLinks, in order.
+	 * Slots are prefetched Distance links ahead so the cache misses of random
+	 * lookups overlap.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) {
+		details::prefetched_walk<Distance>(
+		    iLinks, [this](link iLink) { prefetch_link(iLink); },
+		    [&](link iLink) { iLambda(at(iLink)); });
+	}
+	/**! Lambda called with the object of each link in iLinks, in order */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) const {
+		const_cast<this_type*>(this)->template for_each_link<Distance>(
+		    iLinks, [&](Ty const& iObject) { iLambda(iObject); });
+	}
+	/**!
+	 * Copy the objects of iLinks to oOutput in order, prefetching like
+	 * for_each_link. Returns the iterator past the last copy.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename OutputIt>
+	OutputIt gather(std::span<link const> iLinks, OutputIt oOutput) const {
+		for_each_link<Distance>(iLinks,
+		                        [&](Ty const& iObject) { *oOutput++ = iObject; });
+		return oOutput;
+	}
 
 	inline Ty& at_index(size_type iIndex) { return items_[iIndex].get(); }
 
@@ -194,16 +230,20 @@ public:
 	}
 
 private:
+	/**! Prefetch the slot of iLink, the link is not checked */
+	inline void prefetch_link(link iLink) const noexcept {
+		details::prefetch(&items_[index_t(iLink.value()).index()]);
+	}
 	void push_back(Ty const& x) {
 		if (capacity_ < size_ + 1)
-			unchecked_reserve(size_ + std::max<size_type>(size_ >> 1, 1));
+			grow();
 		items_[size_++].construct(x);
 		valid_count_++;
 	}
 
 	template <class... Args> void emplace_back(Args&&... args) {
 		if (capacity_ < size_ + 1)
-			unchecked_reserve(size_ + std::max<size_type>(size_ >> 1, 1));
+			grow();
 		items_[size_++].construct(std::forward<Args>(args)...);
 		valid_count_++;
 	}
@@ -243,7 +283,10 @@ private:
 		return reinterpret_cast<dbpointer>(Allocator::allocate(n));
 	}
 	inline void deallocate() {
-		Allocator::deallocate(reinterpret_cast<Ty*>(items_), capacity_);
+		if constexpr (k_paged)
+			items_.deallocate(static_cast<Allocator&>(*this));
+		else
+			Allocator::deallocate(reinterpret_cast<Ty*>(items_), capacity_);
 	}
 
 	inline void destroy_and_deallocate() {
@@ -253,15 +296,29 @@ private:
 		valid_count_ = 0;
 	}
 
+	/**! Room for one more slot, paged storage only ever adds a page */
+	inline void grow() {
+		if constexpr (k_paged)
+			unchecked_reserve(size_ + 1);
+		else
+			unchecked_reserve(Growth::grow(size_, size_ + 1, sizeof(Ty)));
+	}
 	inline void unchecked_reserve(size_type n) {
-		dbpointer d = allocate(n);
-		std::memcpy(d, items_, size_ * sizeof(Ty));
-		deallocate();
-		items_    = d;
-		capacity_ = n;
+		if constexpr (k_paged) {
+			// pages are only added, live objects stay where they are
+			items_.reserve(static_cast<Allocator&>(*this), n);
+			capacity_ = items_.capacity();
+		} else {
+			dbpointer d = allocate(n);
+			if (size_)
+				std::memcpy(d, items_, size_ * sizeof(Ty));
+			deallocate();
+			items_    = d;
+			capacity_ = n;
+		}
 	}
 
-	data_block* items_          = nullptr;
+	item_storage items_         = {};
 	size_type size_             = 0;
 	size_type capacity_         = 0;
 	size_type valid_count_      = 0;
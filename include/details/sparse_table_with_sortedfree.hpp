@@ -1,5 +1,13 @@
 #pragma once
 #include "basic_types.hpp"
+#include "bitmap_walk.hpp"
+#include "growth_policy.hpp"
+#include "link_remap.hpp"
+#include "paged_storage.hpp"
+#include "parallel.hpp"
+#include "prefetch.hpp"
+#include <bit>
+#include <span>
 #include <vector>
 
 namespace cpptables {
@@ -8,7 +16,8 @@ namespace details {
 template <typename Ty, typename SizeType = std::uint32_t,
           typename Allocator = std::allocator<Ty>,
           typename Backref   = std::false_type,
-          typename Storage   = std::false_type>
+          typename Storage   = std::false_type,
+          typename Growth    = growth_policy_t<Ty>>
 class sparse_table_with_sortedfree : Allocator {
 
 	union alignas(alignof(Ty)) data_block {
@@ -17,7 +26,6 @@ class sparse_table_with_sortedfree : Allocator {
 		std::uint8_t storage[sizeof(Ty)];
 
 		inline SizeType get_integer() const noexcept { return integer; }
-		inline SizeType* get_integer_p() noexcept { return &integer; }
 		inline void set_integer(SizeType iData) noexcept { integer = iData; }
 
 		inline Ty const& get() const noexcept { return object; }
@@ -45,12 +53,16 @@ class sparse_table_with_sortedfree : Allocator {
 		void destroy() { object.~Ty(); }
 	};
 	using dbpointer = data_block*;
+	using item_storage =
+	    details::item_storage_t<data_block, SizeType, Ty, Storage>;
+	static constexpr bool k_paged = details::is_paged_v<Storage>;
 
 public:
 	using value_type = Ty;
 	using size_type  = SizeType;
 	using this_type =
-	    sparse_table_with_sortedfree<Ty, SizeType, Allocator, Backref, Storage>;
+	    sparse_table_with_sortedfree<Ty, SizeType, Allocator, Backref, Storage,
+	                                 Growth>;
 	using link            = cpptables::link<Ty, SizeType>;
 	using constants       = details::constants<SizeType>;
 	using index_t         = details::index_t<SizeType>;
@@ -60,13 +72,26 @@ public:
 	using const_reference = const value_type&;
 	using pointer         = Ty*;
 	using const_pointer   = const Ty*;
+	using free_word       = std::uint64_t;
+	using free_map        = std::vector<free_word>;
+
+	enum : std::uint32_t { k_free_shift = 6, k_free_mask = 63 };
+	static constexpr free_word k_free_all = ~free_word(0);
 
 	template <typename Container> class iterator_wrapper {
 	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type        = Ty;
+		using difference_type   = this_type::difference_type;
+		using reference =
+		    std::conditional_t<std::is_const_v<Container>, Ty const&, Ty&>;
+		using pointer =
+		    std::conditional_t<std::is_const_v<Container>, Ty const*, Ty*>;
+
 		iterator_wrapper() = default;
-		iterator_wrapper(Container& iCont, const std::uint32_t iIt = 0)
-		    : container(iCont), base(iIt), free_id(iCont.get_first_free_slot()) {
-			to_valid_free_slot();
+		iterator_wrapper(Container& iCont, const size_type iIt = 0)
+		    : container(&iCont), base(iIt) {
+			forward_valid();
 		}
 		iterator_wrapper(const iterator_wrapper&) = default;
 		iterator_wrapper(iterator_wrapper&&)      = default;
@@ -135,30 +160,14 @@ public:
 				forward_valid();
 		}
 
-		auto operator*() { return container[base]; }
-		auto operator-> () { return &container[base]; }
+		reference operator*() const { return container->at_index(base); }
+		pointer operator->() const { return &container->at_index(base); }
 
 	private:
-		inline void to_valid_free_slot() {
-			while (free_id < base)
-				free_id = container.get_next_free_slot(free_id);
-		}
-
-		bool is_valid() const {
-			return base == container.range() || base != free_id;
-		}
-		void forward_valid() {
-			while (!is_valid()) {
-				++base;
-				free_id = container.get_next_free_slot(free_id);
-			}
-		}
-		void backward_valid() {
-			do {
-				free_id = container.get_first_free_slot();
-				to_valid_free_slot();
-			} while (!is_valid() && (--base > 0));
-		}
+		// both directions scan the free bitmap from base, a step costs the same
+		// either way
+		void forward_valid() { base = container->next_valid(base); }
+		void backward_valid() { base = container->prev_valid(base); }
 		void forward_valid(difference_type iAmount) {
 			while (iAmount--)
 				forward_valid();
@@ -168,9 +177,8 @@ public:
 				backward_valid();
 		}
 
-		Container& container = nullptr;
+		Container* container = nullptr;
 		size_type base       = 0;
-		size_type free_id    = constants::k_null;
 	};
 
 	using iterator               = iterator_wrapper<this_type>;
@@ -219,6 +227,41 @@ public:
 	void for_each(size_type iBeg, size_type iEnd, Lambda&& iLambda) const {
 		this_type::for_each(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
 	}
+	/**! details::parallel_for_each, on iExec or the default thread pool */
+	template <typename Executor, typename Lambda>
+	void parallel_for_each(Executor& iExec, Lambda&& iLambda) {
+		details::parallel_for_each(*this, iExec, std::forward<Lambda>(iLambda));
+	}
+	template <typename Executor, typename Lambda>
+	void parallel_for_each(Executor& iExec, Lambda&& iLambda) const {
+		details::parallel_for_each(*this, iExec, std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void parallel_for_each(Lambda&& iLambda) {
+		details::parallel_for_each(*this, default_thread_pool(),
+		                           std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void parallel_for_each(Lambda&& iLambda) const {
+		details::parallel_for_each(*this, default_thread_pool(),
+		                           std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called with a std::span<Ty>, std::span<Ty const> when const, for
+	 * each maximal run of contiguous live objects in [iBeg, iEnd) or range()
+	 */
+	template <typename Lambda> void for_each_run(Lambda&& iLambda) {
+		this_type::for_each_run(*this, 0, range(), std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void for_each_run(Lambda&& iLambda) const {
+		this_type::for_each_run(*this, 0, range(), std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda>
+	void for_each_run(size_type iBeg, size_type iEnd, Lambda&& iLambda) {
+		this_type::for_each_run(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda>
+	void for_each_run(size_type iBeg, size_type iEnd, Lambda&& iLambda) const {
+		this_type::for_each_run(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
 
 	/**! Total number of objects stored in the table */
 	size_type size() const noexcept {
@@ -230,6 +273,12 @@ public:
 	}
 	/**! Total number of slots to effieiencyl do parallel iteration */
 	size_type range() const noexcept { return size_; }
+	/**! Number of live objects in slots [iBeg, iEnd) */
+	size_type live_count(size_type iBeg, size_type iEnd) const {
+		if (iBeg >= iEnd)
+			return 0;
+		return iEnd - iBeg - details::count_free<size_type>(free_, iBeg, iEnd);
+	}
 
 	inline link insert(Ty const& iObject) {
 		size_type index = first_free_index_;
@@ -240,7 +289,8 @@ public:
 			spoilers.emplace_back(0);
 #endif
 		} else {
-			first_free_index_ = items_[index].get_integer();
+			mark_used(index);
+			first_free_index_ = take_free_slot(index);
 			items_[index].construct(iObject);
 			valid_count_++;
 		}
@@ -260,7 +310,8 @@ public:
 			spoilers.emplace_back(0);
 #endif
 		} else {
-			first_free_index_ = items_[index].get_integer();
+			mark_used(index);
+			first_free_index_ = take_free_slot(index);
 			items_[index].construct(std::forward<Args>(args)...);
 			valid_count_++;
 		}
@@ -277,10 +328,12 @@ public:
 		index_t index(id);
 		id = index.index();
 		assert(spoilers[id] == index.spoiler());
-		spoilers[id] = (spoilers[id] + 1) & 0x7f;
+		spoilers[id] = (spoilers[id] + 1) & constants::k_spoiler_max;
 #endif
 		items_[id].destroy();
-		insert_free_index(id);
+		mark_free(id);
+		if (id < first_free_index_)
+			first_free_index_ = id;
 		valid_count_--;
 	}
 
@@ -297,6 +350,33 @@ public:
 	inline Ty const& at(link iIndex) const {
 		return const_cast<Ty const&>(const_cast<this_type*>(this)->at(iIndex));
 	}
+	/**!
+	 * Lambda called with the object of each link in iLinks, in order.
+	 * Slots are prefetched Distance links ahead so the cache misses of random
+	 * lookups overlap.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) {
+		details::prefetched_walk<Distance>(
+		    iLinks, [this](link iLink) { prefetch_link(iLink); },
+		    [&](link iLink) { iLambda(at(iLink)); });
+	}
+	/**! Lambda called with the object of each link in iLinks, in order */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) const {
+		const_cast<this_type*>(this)->template for_each_link<Distance>(
+		    iLinks, [&](Ty const& iObject) { iLambda(iObject); });
+	}
+	/**!
+	 * Copy the objects of iLinks to oOutput in order, prefetching like
+	 * for_each_link. Returns the iterator past the last copy.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename OutputIt>
+	OutputIt gather(std::span<link const> iLinks, OutputIt oOutput) const {
+		for_each_link<Distance>(iLinks,
+		                        [&](Ty const& iObject) { *oOutput++ = iObject; });
+		return oOutput;
+	}
 
 	inline Ty& at_index(size_type iIndex) { return items_[iIndex].get(); }
 
@@ -308,15 +388,15 @@ public:
 	// Iterators
 	iterator begin() { return iterator(*this); }
 	iterator end() { return iterator(*this, size_); }
-	const_iterator begin() const { return iterator(*this); }
-	const_iterator end() const { return iterator(*this, size_); }
-	reverse_iterator rbegin() { return reverse_iterator(iterator(*this, size_)); }
-	reverse_iterator rend() { return reverse_iterator(iterator(*this, 0)); }
+	const_iterator begin() const { return const_iterator(*this); }
+	const_iterator end() const { return const_iterator(*this, size_); }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
 	const_reverse_iterator rbegin() const {
-		return const_reverse_iterator(const_iterator(*this, size_));
+		return const_reverse_iterator(end());
 	}
 	const_reverse_iterator rend() const {
-		return const_reverse_iterator(const_iterator(*this, 0));
+		return const_reverse_iterator(begin());
 	}
 
 	static void set_link(Ty& ioObj, link iLink) {}
@@ -325,119 +405,284 @@ public:
 	void clear() {
 		size_        = 0;
 		valid_count_ = 0;
+		free_.clear();
+		free_summary_.clear();
 #ifdef CPPTABLES_DEBUG
 		spoilers.clear();
 #endif
 		first_free_index_ = constants::k_null;
 	}
+
+	/**!
+	 * Move the live objects at the end of the table into the lowest free
+	 * slots until no hole is left, then release the tail storage. Returns
+	 * the links that changed.
+	 */
+	link_remap<link> compact() {
+		link_remap<link> remap;
+		compact_step(constants::k_null, remap);
+		return remap;
+	}
+	/**!
+	 * compact() spread over several calls, at most iBudget objects are moved.
+	 * oRemap receives the links changed by this step only, apply it before
+	 * the next erase. Returns true once no hole is left.
+	 */
+	bool compact_step(size_type iBudget, link_remap<link>& oRemap) {
+		oRemap.clear();
+		if (!size_)
+			return true;
+		size_type hole = first_free_index_;
+		size_type last = prev_valid(size_ - 1);
+		for (size_type moved = 0;
+		     last != constants::k_null && hole < last && moved < iBudget;
+		     ++moved) {
+			move_slot(last, hole, oRemap);
+			hole = next_free(hole + 1);
+			last = prev_valid(last - 1);
+		}
+		trim(last == constants::k_null ? 0 : last + 1);
+		oRemap.sort();
+		if (first_free_index_ != constants::k_null)
+			return false;
+		shrink_storage();
+		return true;
+	}
 	inline size_type get_first_free_slot() const { return first_free_index_; }
 	inline size_type get_next_free_slot(size_type iIdx) const {
-		return items_[iIdx].get_integer();
+		return next_free(iIdx + 1);
+	}
+	inline bool is_free(size_type iIdx) const {
+		size_type w = iIdx >> k_free_shift;
+		return w < free_.size() &&
+		       (free_[w] & (free_word(1) << (iIdx & k_free_mask))) != 0;
 	}
 
 private:
-	void insert_free_index(size_type iItem) {
-		size_type* prev = &first_free_index_;
-		size_type curr  = first_free_index_;
-
-		while (curr < iItem) {
-			prev = items_[curr].get_integer_p();
-			curr = *prev;
+	/**! Prefetch the slot of iLink, the link is not checked */
+	inline void prefetch_link(link iLink) const noexcept {
+		details::prefetch(&items_[index_t(iLink.value()).index()]);
+	}
+	void move_slot(size_type iFrom, size_type iTo, link_remap<link>& oRemap) {
+		items_[iTo].construct(std::move(items_[iFrom].get()));
+		items_[iFrom].destroy();
+		mark_used(iTo);
+		mark_free(iFrom);
+		link from(iFrom);
+		link to(iTo);
+#ifdef CPPTABLES_DEBUG
+		from = link(index_t(iFrom, spoilers[iFrom]).value());
+		to   = link(index_t(iTo, spoilers[iTo]).value());
+#endif
+		set_link(items_[iTo].get(), to);
+		oRemap.add(from, to);
+	}
+	/**! Drop the free slots from iEnd on, all slots past iEnd are free */
+	void trim(size_type iEnd) {
+		size_           = iEnd;
+		size_type words = (iEnd + k_free_mask) >> k_free_shift;
+		if (free_.size() > words) {
+			free_.resize(words);
+			free_summary_.resize(words ? ((words - 1) >> k_free_shift) + 1 : 0);
+			if (words & k_free_mask)
+				free_summary_.back() &= k_free_all >> (64 - (words & k_free_mask));
+		}
+		if (words && (iEnd & k_free_mask)) {
+			size_type w = words - 1;
+			free_[w] &= k_free_all >> (64 - (iEnd & k_free_mask));
+			if (!free_[w])
+				free_summary_[w >> k_free_shift] &=
+				    ~(free_word(1) << (w & k_free_mask));
+		}
+#ifdef CPPTABLES_DEBUG
+		spoilers.resize(iEnd);
+#endif
+		first_free_index_ = next_free(0);
+	}
+	/**! Give back the storage past size_ */
+	void shrink_storage() {
+		if constexpr (k_paged) {
+			items_.shrink(static_cast<Allocator&>(*this), size_);
+			capacity_ = items_.capacity();
+		} else if (capacity_ > size_) {
+			if (size_)
+				unchecked_reserve(size_);
+			else {
+				deallocate();
+				items_    = nullptr;
+				capacity_ = 0;
+			}
+		}
+	}
+	/**!
+	 * Free slots are tracked in a bitmap, a second level keeps one bit per
+	 * word that has a free slot so the lowest free slot is found with two
+	 * countr_zero instead of walking a sorted list
+	 */
+	void mark_free(size_type iIdx) {
+		size_type w = iIdx >> k_free_shift;
+		if (w >= free_.size()) {
+			free_.resize(w + 1, 0);
+			free_summary_.resize((w >> k_free_shift) + 1, 0);
 		}
-		*prev = iItem;
-		items_[iItem].set_integer(curr);
-		return;
+		free_[w] |= free_word(1) << (iIdx & k_free_mask);
+		free_summary_[w >> k_free_shift] |= free_word(1) << (w & k_free_mask);
+	}
+	void mark_used(size_type iIdx) {
+		size_type w = iIdx >> k_free_shift;
+		free_[w] &= ~(free_word(1) << (iIdx & k_free_mask));
+		if (!free_[w])
+			free_summary_[w >> k_free_shift] &= ~(free_word(1) << (w & k_free_mask));
+	}
+	/**! First valid slot at or after iIdx, range() if there is none */
+	size_type next_valid(size_type iIdx) const {
+		return std::min(
+		    details::next_live(free_, iIdx, details::scan_words<size_type>{free_}),
+		    size_);
+	}
+	/**! Last valid slot at or before iIdx, k_null if there is none */
+	size_type prev_valid(size_type iIdx) const {
+		return details::prev_live(free_, iIdx,
+		                          details::scan_words<size_type>{free_});
+	}
+	/**! Lowest free slot left once iIdx has been handed out */
+	size_type take_free_slot(size_type iIdx) const {
+		return size_ - valid_count_ > 1
+		           ? next_free(iIdx + 1)
+		           : static_cast<size_type>(constants::k_null);
+	}
+	/**! Lowest free slot at or after iIdx, k_null if there is none */
+	size_type next_free(size_type iIdx) const {
+		size_type w = iIdx >> k_free_shift;
+		if (w >= free_.size())
+			return constants::k_null;
+		free_word bits = free_[w] & (k_free_all << (iIdx & k_free_mask));
+		if (bits)
+			return (w << k_free_shift) +
+			       static_cast<size_type>(std::countr_zero(bits));
+		size_type s = ++w >> k_free_shift;
+		if (s >= free_summary_.size())
+			return constants::k_null;
+		free_word words = free_summary_[s] & (k_free_all << (w & k_free_mask));
+		while (!words) {
+			if (++s == free_summary_.size())
+				return constants::k_null;
+			words = free_summary_[s];
+		}
+		w = (s << k_free_shift) + static_cast<size_type>(std::countr_zero(words));
+		return (w << k_free_shift) +
+		       static_cast<size_type>(std::countr_zero(free_[w]));
 	}
 	void push_back(Ty const& x) {
 		if (capacity_ < size_ + 1)
-			unchecked_reserve(size_ + std::max<size_type>(size_ >> 1, 1));
+			grow();
 		items_[size_++].construct(x);
 		valid_count_++;
 	}
 
 	template <class... Args> void emplace_back(Args&&... args) {
 		if (capacity_ < size_ + 1)
-			unchecked_reserve(size_ + std::max<size_type>(size_ >> 1, 1));
+			grow();
 		items_[size_++].construct(std::forward<Args>(args)...);
 		valid_count_++;
 	}
 
+	template <typename Lambda, typename Type>
+	inline static void for_each_run(Type& iCont, size_type iBegin,
+	                                size_type iEnd, Lambda&& iLambda) {
+		static_assert(details::is_array_layout_v<data_block, Ty>,
+		              "Runs need the slots laid out as an array of Ty");
+		details::for_each_live_run(
+		    iCont.free_, iBegin, iEnd, details::scan_words<size_type>{iCont.free_},
+		    [&](size_type iFirst, size_type iLast) {
+			    if constexpr (k_paged) {
+				    // a run spanning pages is handed out a page at a time
+				    while (iFirst < iLast) {
+					    size_type stop =
+					        std::min(iLast, item_storage::page_end(iFirst));
+					    std::forward<Lambda>(iLambda)(
+					        std::span(&iCont.items_[iFirst].get(), stop - iFirst));
+					    iFirst = stop;
+				    }
+			    } else {
+				    std::forward<Lambda>(iLambda)(
+				        std::span(&iCont.items_[iFirst].get(), iLast - iFirst));
+			    }
+		    });
+	}
 	template <typename Lambda, typename Type>
 	inline static void for_each(Type& iCont, Lambda&& iLambda) {
-		size_type begin = 0;
-		size_type end   = iCont.size_;
-		size_type fri   = iCont.first_free_index_;
-		for (; begin < end; ++begin) {
-			if (begin != fri)
-				std::forward<Lambda>(iLambda)(iCont.items_[begin].get());
-			else
-				fri = iCont.get_next_free_slot(fri);
-		}
+		for_each(iCont, 0, iCont.size_, std::forward<Lambda>(iLambda));
 	}
 	template <typename Lambda, typename Type>
 	inline static void for_each(Type& iCont, size_type iBegin, size_type iEnd,
 	                            Lambda&& iLambda) {
-		size_type begin = iBegin;
-		size_type end   = iEnd;
-		size_type fri   = iCont.first_free_index_;
-		while (fri < begin)
-			fri = iCont.get_next_free_slot(fri);
-		for (; begin < end; ++begin) {
-			if (begin != fri)
-				std::forward<Lambda>(iLambda)(iCont.items_[begin].get());
-			else
-				fri = iCont.get_next_free_slot(fri);
-		}
+		details::for_each_live(iCont.free_, iBegin, iEnd,
+		                       details::scan_words<size_type>{iCont.free_},
+		                       [&](size_type i) {
+			                       std::forward<Lambda>(iLambda)(iCont.items_[i].get());
+		                       });
 	}
 	inline dbpointer allocate(size_type n) {
 		return reinterpret_cast<dbpointer>(Allocator::allocate(n));
 	}
 	inline void deallocate() {
-		Allocator::deallocate(reinterpret_cast<Ty*>(items_), capacity_);
+		if constexpr (k_paged)
+			items_.deallocate(static_cast<Allocator&>(*this));
+		else
+			Allocator::deallocate(reinterpret_cast<Ty*>(items_), capacity_);
 	}
 
 	inline void destroy_and_deallocate() {
 
 		if constexpr (!std::is_trivially_destructible_v<Ty>) {
-			size_type fri = first_free_index_;
-			for (size_type i = 0; i < size_; ++i) {
-				if (i != fri)
-					items_[i].get().~Ty();
-				else
-					fri = get_next_free_slot(fri);
-			}
+			for_each([](Ty& oObj) { oObj.~Ty(); });
 		}
 		deallocate();
 		capacity_    = 0;
 		size_        = 0;
 		valid_count_ = 0;
+		free_.clear();
+		free_summary_.clear();
 	}
 
+	/**! Room for one more slot, paged storage only ever adds a page */
+	inline void grow() {
+		if constexpr (k_paged)
+			unchecked_reserve(size_ + 1);
+		else
+			unchecked_reserve(Growth::grow(size_, size_ + 1, sizeof(Ty)));
+	}
 	inline void unchecked_reserve(size_type n) {
-		dbpointer d = allocate(n);
-		if (std::is_trivially_copyable_v<Ty>)
-			std::memcpy(d, items_, size_ * sizeof(Ty));
-		else {
-			size_type mcopy = std::min<size_type>(size_, n);
-			size_type fri   = first_free_index_;
-			for (size_type i = 0; i < mcopy; ++i) {
-				if (i != fri) {
-					d[i].construct(std::move(items_[i].get()));
-					if constexpr (!std::is_trivially_destructible_v<Ty>) {
-						items_[i].get().~Ty();
+		if constexpr (k_paged) {
+			// pages are only added, live objects stay where they are
+			items_.reserve(static_cast<Allocator&>(*this), n);
+			capacity_ = items_.capacity();
+		} else {
+			dbpointer d = allocate(n);
+			if (std::is_trivially_copyable_v<Ty>) {
+				if (size_)
+					std::memcpy(d, items_, size_ * sizeof(Ty));
+			} else {
+				size_type mcopy = std::min<size_type>(size_, n);
+				for (size_type i = 0; i < mcopy; ++i) {
+					if (!is_free(i)) {
+						d[i].construct(std::move(items_[i].get()));
+						if constexpr (!std::is_trivially_destructible_v<Ty>) {
+							items_[i].get().~Ty();
+						}
 					}
-				} else {
-					fri = get_next_free_slot(fri);
-					d[i].set_integer(items_[i].get_integer());
 				}
 			}
+			deallocate();
+			items_    = d;
+			capacity_ = n;
 		}
-		deallocate();
-		items_    = d;
-		capacity_ = n;
 	}
 
-	data_block* items_          = nullptr;
+	item_storage items_ = {};
+	free_map free_;
+	free_map free_summary_;
 	size_type size_             = 0;
 	size_type capacity_         = 0;
 	size_type valid_count_      = 0;
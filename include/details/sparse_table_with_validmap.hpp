@@ -1,5 +1,16 @@
 #pragma once
 #include "basic_types.hpp"
+#include "bitmap_walk.hpp"
+#include "cold_storage.hpp"
+#include "growth_policy.hpp"
+#include "link_remap.hpp"
+#include "paged_storage.hpp"
+#include "parallel.hpp"
+#include "prefetch.hpp"
+#include <bit>
+#include <span>
+#include <stdexcept>
+#include <tuple>
 #include <vector>
 
 namespace cpptables {
@@ -8,7 +19,11 @@ namespace details {
 template <typename Ty, typename SizeType = std::uint32_t,
           typename Allocator = std::allocator<Ty>,
           typename Backref   = std::false_type,
-          typename Storage   = std::false_type>
+          typename Storage   = std::false_type,
+          typename Summary   = std::false_type,
+          typename Growth    = growth_policy_t<Ty>,
+          typename Cold      = void,
+          typename Generation = no_generations>
 class sparse_table_with_validmap : Allocator {
 
 	union alignas(alignof(Ty)) data_block {
@@ -43,17 +58,60 @@ class sparse_table_with_validmap : Allocator {
 		}
 		void destroy() { object.~Ty(); }
 	};
-	using dbpointer = data_block*;
+	/**!
+	 * Slot of a generational table, the generation follows the object so the
+	 * load that checks a link also brings in the object. Free slots have
+	 * k_free_generation set, which no link generation has.
+	 */
+	struct generational_block {
+		data_block block;
+		std::uint8_t generation;
+
+		inline SizeType get_integer() const noexcept {
+			return block.get_integer();
+		}
+		inline void set_integer(SizeType iData) noexcept {
+			block.set_integer(iData);
+		}
+		inline Ty const& get() const noexcept { return block.get(); }
+		inline Ty& get() noexcept { return block.get(); }
+		template <typename... Args> void construct(Args&&... args) {
+			block.construct(std::forward<Args>(args)...);
+		}
+		void destroy() { block.destroy(); }
+	};
+	enum : std::uint8_t { k_free_generation = 0x80 };
+	static constexpr bool k_generational = Generation::value;
+	using block_type =
+	    std::conditional_t<k_generational, generational_block, data_block>;
+	using block_allocator = std::conditional_t<
+	    k_generational,
+	    typename std::allocator_traits<Allocator>::template rebind_alloc<
+	        block_type>,
+	    Allocator>;
+	using dbpointer = block_type*;
+	using generation_map =
+	    std::conditional_t<k_generational, std::vector<std::uint8_t>,
+	                       std::tuple<>>;
+	using item_storage =
+	    details::item_storage_t<block_type, SizeType, Ty, Storage>;
+	static constexpr bool k_paged = details::is_paged_v<Storage>;
+	using cold_storage =
+	    details::cold_array<Cold, SizeType, Allocator,
+	                        k_paged ? unsigned(page_traits<Ty, Storage>::shift)
+	                                : 0u>;
 
 public:
 	using value_type = Ty;
 	using size_type  = SizeType;
 	using this_type =
-	    sparse_table_with_validmap<Ty, SizeType, Allocator, Backref, Storage>;
+	    sparse_table_with_validmap<Ty, SizeType, Allocator, Backref, Storage,
+	                               Summary, Growth, Cold, Generation>;
 	using link            = cpptables::link<Ty, size_type>;
 	using constants       = details::constants<SizeType>;
 	using index_t         = details::index_t<SizeType>;
-	using usage_map       = std::vector<std::uint32_t>;
+	using usage_word      = std::uint64_t;
+	using usage_map       = std::vector<usage_word>;
 	using allocator_type  = Allocator;
 	using difference_type = std::ptrdiff_t;
 	using reference       = value_type&;
@@ -64,11 +122,36 @@ public:
 	static_assert(sizeof(size_type) <= sizeof(Ty),
 	              "size_ of object should be greater than or equal to 4 bytes");
 
+	enum : std::uint32_t { k_usage_shift = 6, k_usage_mask = 63 };
+	static constexpr usage_word k_usage_all = ~usage_word(0);
+	/**!
+	 * With a summary, one bit per usage word is kept set while that word has a
+	 * live slot, iteration then skips free words 64 at a time
+	 */
+	static constexpr bool k_summary = Summary::value;
+	/**!
+	 * With a Cold type every slot also has a Cold object in a parallel array,
+	 * Ty is the hot part walked by for_each and Cold is only reached through
+	 * cold() or for_each_hot_cold
+	 */
+	using cold_type              = Cold;
+	static constexpr bool k_cold = !std::is_void_v<Cold>;
+
 	template <typename Container> class iterator_wrapper {
 	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type        = Ty;
+		using difference_type   = std::ptrdiff_t;
+		using reference =
+		    std::conditional_t<std::is_const_v<Container>, Ty const&, Ty&>;
+		using pointer =
+		    std::conditional_t<std::is_const_v<Container>, Ty const*, Ty*>;
+
 		iterator_wrapper() = default;
-		iterator_wrapper(Container& iCont, const std::uint32_t iIt = 0)
-		    : container(iCont), base(iIt) {}
+		iterator_wrapper(Container& iCont, const size_type iIt = 0)
+		    : container(&iCont), base(iIt) {
+			forward_valid();
+		}
 		iterator_wrapper(const iterator_wrapper&) = default;
 		iterator_wrapper(iterator_wrapper&&)      = default;
 		iterator_wrapper& operator=(const iterator_wrapper&) = default;
@@ -136,21 +219,12 @@ public:
 				forward_valid();
 		}
 
-		auto operator*() { return container[base]; }
-		auto operator-> () { return &container[base]; }
+		reference operator*() const { return container->at_index(base); }
+		pointer operator->() const { return &container->at_index(base); }
 
 	private:
-		bool is_valid() const {
-			return base == container.range() || container.is_valid(base);
-		}
-		void forward_valid() {
-			while (!is_valid())
-				++base;
-		}
-		void backward_valid() {
-			while (!is_valid())
-				--base;
-		}
+		void forward_valid() { base = container->next_valid(base); }
+		void backward_valid() { base = container->prev_valid(base); }
 		void forward_valid(difference_type iAmount) {
 			while (iAmount--)
 				forward_valid();
@@ -160,7 +234,7 @@ public:
 				backward_valid();
 		}
 
-		Container& container = nullptr;
+		Container* container = nullptr;
 		size_type base       = 0;
 	};
 
@@ -210,25 +284,100 @@ public:
 	void for_each(size_type iBeg, size_type iEnd, Lambda&& iLambda) const {
 		this_type::for_each(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
 	}
+	/**!
+	 * Lambda called for the hot part of each element, same as for_each
+	 */
+	template <typename Lambda> void for_each_hot(Lambda&& iLambda) {
+		this_type::for_each(*this, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for the hot part of each element, same as for_each
+	 */
+	template <typename Lambda> void for_each_hot(Lambda&& iLambda) const {
+		this_type::for_each(*this, std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called for each element, Lambda should accept (Ty&, Cold&)
+	 */
+	template <typename Lambda>
+	void for_each_hot_cold(Lambda&& iLambda) requires k_cold {
+		this_type::for_each_index(*this, 0, size_, [&](size_type i) {
+			std::forward<Lambda>(iLambda)(items_[i].get(), cold_.get(i));
+		});
+	}
+	/**!
+	 * Lambda called for each element, Lambda should accept
+	 * (Ty const&, Cold const&)
+	 */
+	template <typename Lambda>
+	void for_each_hot_cold(Lambda&& iLambda) const requires k_cold {
+		this_type::for_each_index(*this, 0, size_, [&](size_type i) {
+			std::forward<Lambda>(iLambda)(items_[i].get(), cold_.get(i));
+		});
+	}
+	/**! details::parallel_for_each, on iExec or the default thread pool */
+	template <typename Executor, typename Lambda>
+	void parallel_for_each(Executor& iExec, Lambda&& iLambda) {
+		details::parallel_for_each(*this, iExec, std::forward<Lambda>(iLambda));
+	}
+	template <typename Executor, typename Lambda>
+	void parallel_for_each(Executor& iExec, Lambda&& iLambda) const {
+		details::parallel_for_each(*this, iExec, std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void parallel_for_each(Lambda&& iLambda) {
+		details::parallel_for_each(*this, default_thread_pool(),
+		                           std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void parallel_for_each(Lambda&& iLambda) const {
+		details::parallel_for_each(*this, default_thread_pool(),
+		                           std::forward<Lambda>(iLambda));
+	}
+	/**!
+	 * Lambda called with a std::span<Ty>, std::span<Ty const> when const, for
+	 * each maximal run of contiguous live objects in [iBeg, iEnd) or range()
+	 */
+	template <typename Lambda> void for_each_run(Lambda&& iLambda) {
+		this_type::for_each_run(*this, 0, range(), std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda> void for_each_run(Lambda&& iLambda) const {
+		this_type::for_each_run(*this, 0, range(), std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda>
+	void for_each_run(size_type iBeg, size_type iEnd, Lambda&& iLambda) {
+		this_type::for_each_run(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda>
+	void for_each_run(size_type iBeg, size_type iEnd, Lambda&& iLambda) const {
+		this_type::for_each_run(*this, iBeg, iEnd, std::forward<Lambda>(iLambda));
+	}
 
 	template <bool iValue> constexpr void set_usage(size_type it) {
-		size_type id = it >> 5;
+		size_type id = it >> k_usage_shift;
 		if (id >= usage_.size()) {
 			if constexpr (iValue)
 				return;
-			usage_.resize(id + 1, 0);
+			grow_usage(id + 1);
+		}
+		usage_word bit = usage_word(1) << (it & k_usage_mask);
+		if constexpr (iValue) {
+			usage_[id] &= ~bit;
+			if constexpr (k_summary)
+				summary_[id >> k_usage_shift] |= usage_word(1)
+				                                 << (id & k_usage_mask);
+		} else {
+			usage_[id] |= bit;
+			if constexpr (k_summary) {
+				if (usage_[id] == k_usage_all)
+					summary_[id >> k_usage_shift] &=
+					    ~(usage_word(1) << (id & k_usage_mask));
+			}
 		}
-		std::uint32_t bit = static_cast<std::uint32_t>(it & 31);
-		if constexpr (iValue)
-			usage_[id] &= ~(1 << bit);
-		else
-			usage_[id] |= (1 << bit);
 	}
 
 	constexpr bool is_valid(size_type it) const {
-		size_type id = it >> 5;
+		size_type id = it >> k_usage_shift;
 		return id >= usage_.size() ||
-		       ((usage_[id] & (1 << static_cast<std::uint32_t>(it & 31))) == 0);
+		       ((usage_[id] & (usage_word(1) << (it & k_usage_mask))) == 0);
 	}
 	/**! Total number of objects stored in the table */
 	size_type size() const noexcept {
@@ -240,73 +389,84 @@ public:
 	}
 	/**! Total number of slots to effieiencyl do parallel iteration */
 	size_type range() const noexcept { return size_; }
+	/**! Number of live objects in slots [iBeg, iEnd) */
+	size_type live_count(size_type iBeg, size_type iEnd) const {
+		if (iBeg >= iEnd)
+			return 0;
+		return iEnd - iBeg - details::count_free<size_type>(usage_, iBeg, iEnd);
+	}
 
-	inline link insert(Ty const& iObject) {
-		size_type index = first_free_index_;
-		if (index == constants::k_null) {
-			index = static_cast<size_type>(size_);
-			push_back(iObject);
-#ifdef CPPTABLES_DEBUG
-			spoilers.emplace_back(0);
-#endif
-		} else {
-			first_free_index_ = items_[index].get_integer();
-			if (first_free_index_ == constants::k_null)
-				usage_.clear();
-			items_[index].construct(iObject);
-			set_usage<true>(index);
-		}
-		size_type link_numbr = index;
-#ifdef CPPTABLES_DEBUG
-		link_numbr = index_t(index, spoilers[index]).value();
-#endif
-		valid_count_++;
-		return link(link_numbr);
+	inline link insert(Ty const& iObject) { return insert_split(iObject); }
+	/**! Insert the hot and the cold part of an object */
+	template <typename C = Cold>
+	inline link insert(Ty const& iObject, C const& iCold) requires k_cold {
+		return insert_split(iObject, iCold);
 	}
 
 	template <typename... Args> inline link emplace(Args&&... args) {
 		size_type index = first_free_index_;
 		if (index == constants::k_null) {
+			if (out_of_links())
+				return link();
 			index = static_cast<size_type>(size_);
 			emplace_back(std::forward<Args>(args)...);
 #ifdef CPPTABLES_DEBUG
-			spoilers.emplace_back(0);
+			spoilers.emplace_back(generation_of(index));
 #endif
 		} else {
 			first_free_index_ = items_[index].get_integer();
 			if (first_free_index_ == constants::k_null)
-				usage_.clear();
+				clear_usage();
 			items_[index].construct(std::forward<Args>(args)...);
 			set_usage<true>(index);
 		}
+		cold_.construct(index);
 		size_type link_numbr = index;
 #ifdef CPPTABLES_DEBUG
 		link_numbr = index_t(index, spoilers[index]).value();
 #endif
+		link_numbr = make_current(index, link_numbr);
 		valid_count_++;
 		return link(link_numbr);
 	}
 
-	inline void erase(link iIndex) {
-		size_type id = iIndex.value();
+	/**! Erase an object, false if the link is stale (with generations) */
+	inline bool erase(link iIndex) {
+		size_type id = slot_of(iIndex.value());
+		if constexpr (k_generational) {
+			if (id >= size_ || !is_current(iIndex.value()))
+				return false;
+			retire(id);
+		}
 #ifdef CPPTABLES_DEBUG
-		index_t index(id);
+		index_t index(iIndex.value());
 		id = index.index();
 		assert(spoilers[id] == index.spoiler());
-		spoilers[id] = (spoilers[id] + 1) & 0x7f;
+		spoilers[id] = (spoilers[id] + 1) & constants::k_spoiler_max;
 #endif
 		items_[id].destroy();
+		cold_.destroy(id);
 		items_[id].set_integer(first_free_index_);
 		valid_count_--;
 		set_usage<false>(id);
 
 		first_free_index_ = id;
+		compact_range_    = constants::k_null;
+		return true;
 	}
 
+	/**!
+	 * Locate an object using its link, with generations a stale link throws
+	 * std::out_of_range
+	 */
 	inline Ty& at(link iIndex) {
-		size_type id = iIndex.value();
+		size_type id = slot_of(iIndex.value());
+		if constexpr (k_generational) {
+			if (id >= size_ || !is_current(iIndex.value()))
+				throw std::out_of_range("Stale link");
+		}
 #ifdef CPPTABLES_DEBUG
-		index_t index(id);
+		index_t index(iIndex.value());
 		id = index.index();
 		assert(spoilers[id] == index.spoiler());
 #endif
@@ -316,6 +476,75 @@ public:
 	inline Ty const& at(link iIndex) const {
 		return const_cast<Ty const&>(const_cast<this_type*>(this)->at(iIndex));
 	}
+	/**!
+	 * Object at iIndex or nullptr if the link is out of range or its object
+	 * was erased. Stale links are only caught with generations, where the
+	 * check reads the slot holding the object and nothing else.
+	 */
+	inline Ty* try_at(link iIndex) noexcept {
+		size_type id = slot_of(iIndex.value());
+#ifdef CPPTABLES_DEBUG
+		index_t index(iIndex.value());
+		id = index.index();
+		if (id < size_ && spoilers[id] != index.spoiler())
+			return nullptr;
+#endif
+		if (id >= size_)
+			return nullptr;
+		if constexpr (k_generational) {
+			if (!is_current(iIndex.value()))
+				return nullptr;
+		} else if (!is_valid(id)) {
+			return nullptr;
+		}
+		return &items_[id].get();
+	}
+	/**! Object at iIndex or nullptr, see try_at */
+	inline Ty const* try_at(link iIndex) const noexcept {
+		return const_cast<this_type*>(this)->try_at(iIndex);
+	}
+	/**!
+	 * Lambda called with the object of each link in iLinks, in order.
+	 * Slots are prefetched Distance links ahead so the cache misses of random
+	 * lookups overlap.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) {
+		details::prefetched_walk<Distance>(
+		    iLinks, [this](link iLink) { prefetch_link(iLink); },
+		    [&](link iLink) { iLambda(at(iLink)); });
+	}
+	/**! Lambda called with the object of each link in iLinks, in order */
+	template <std::size_t Distance = k_prefetch_distance, typename Lambda>
+	void for_each_link(std::span<link const> iLinks, Lambda&& iLambda) const {
+		const_cast<this_type*>(this)->template for_each_link<Distance>(
+		    iLinks, [&](Ty const& iObject) { iLambda(iObject); });
+	}
+	/**!
+	 * Copy the objects of iLinks to oOutput in order, prefetching like
+	 * for_each_link. Returns the iterator past the last copy.
+	 */
+	template <std::size_t Distance = k_prefetch_distance, typename OutputIt>
+	OutputIt gather(std::span<link const> iLinks, OutputIt oOutput) const {
+		for_each_link<Distance>(iLinks,
+		                        [&](Ty const& iObject) { *oOutput++ = iObject; });
+		return oOutput;
+	}
+	/**! Cold part of the object at iIndex */
+	template <typename C = Cold> inline C& cold(link iIndex) requires k_cold {
+		size_type id = iIndex.value();
+#ifdef CPPTABLES_DEBUG
+		index_t index(id);
+		id = index.index();
+		assert(spoilers[id] == index.spoiler());
+#endif
+		return cold_.get(slot_of(id));
+	}
+	/**! Cold part of the object at iIndex */
+	template <typename C = Cold>
+	inline C const& cold(link iIndex) const requires k_cold {
+		return const_cast<this_type*>(this)->cold(iIndex);
+	}
 
 	inline Ty& at_index(size_type iIndex) { return items_[iIndex].get(); }
 
@@ -327,79 +556,426 @@ public:
 	// Iterators
 	iterator begin() { return iterator(*this); }
 	iterator end() { return iterator(*this, size_); }
-	const_iterator begin() const { return iterator(*this); }
-	const_iterator end() const { return iterator(*this, size_); }
-	reverse_iterator rbegin() { return reverse_iterator(iterator(*this, size_)); }
-	reverse_iterator rend() { return reverse_iterator(iterator(*this, 0)); }
+	const_iterator begin() const { return const_iterator(*this); }
+	const_iterator end() const { return const_iterator(*this, size_); }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
 	const_reverse_iterator rbegin() const {
-		return const_reverse_iterator(const_iterator(*this, size_));
+		return const_reverse_iterator(end());
 	}
 	const_reverse_iterator rend() const {
-		return const_reverse_iterator(const_iterator(*this, 0));
+		return const_reverse_iterator(begin());
 	}
 
 	static void set_link(Ty& ioObj, link iLink) {}
 	static link get_link(Ty const& ioObj) { return {}; }
 
 	void clear() {
-		usage_.clear();
+		drop_generations(0, size_);
+		clear_usage();
 		size_        = 0;
 		valid_count_ = 0;
 #ifdef CPPTABLES_DEBUG
 		spoilers.clear();
 #endif
 		first_free_index_ = constants::k_null;
+		compact_holes_    = {};
+		compact_lo_       = 0;
+	}
+
+	/**!
+	 * Move the live objects at the end of the table into the lowest free
+	 * slots until no hole is left, then release the tail storage. Returns
+	 * the links that changed.
+	 */
+	link_remap<link> compact() {
+		link_remap<link> remap;
+		compact_step(constants::k_null, remap);
+		return remap;
+	}
+	/**!
+	 * compact() spread over several calls, at most iBudget objects are moved.
+	 * oRemap receives the links changed by this step only, apply it before
+	 * the next erase. The first step after the free list changed collects
+	 * it from the usage map, later steps cost O(iBudget) plus the tail slots
+	 * they release. Returns true once no hole is left.
+	 */
+	bool compact_step(size_type iBudget, link_remap<link>& oRemap) {
+		oRemap.clear();
+		if (!size_)
+			return true;
+		if (compact_head_ != first_free_index_ || compact_range_ != range())
+			sort_free_list();
+		size_type last = prev_valid(size_ - 1);
+		for (size_type moved = 0; compact_lo_ < compact_holes_.size() &&
+		                          last != constants::k_null && moved < iBudget;
+		     ++moved) {
+			size_type hole = compact_holes_[compact_lo_];
+			if (hole > last)
+				break;
+			move_slot(last, hole, oRemap);
+			compact_lo_++;
+			last = prev_valid(last - 1);
+		}
+		trim(last == constants::k_null ? 0 : last + 1);
+		oRemap.sort();
+		if (first_free_index_ != constants::k_null)
+			return false;
+		compact_holes_ = {};
+		compact_lo_    = 0;
+		shrink_storage();
+		return true;
 	}
 
 private:
+	/**! Slot addressed by a link value, generation bits dropped */
+	static inline size_type slot_of(size_type iLink) noexcept {
+		if constexpr (k_generational)
+			return iLink & constants::k_index_mask;
+		else
+			return iLink;
+	}
+	/**! Prefetch the slot of iLink, the link is not checked */
+	inline void prefetch_link(link iLink) const noexcept {
+		details::prefetch(&items_[slot_of(index_t(iLink.value()).index())]);
+	}
+	/**! Link value iLink carries the generation of its live slot */
+	inline bool is_current(size_type iLink) const noexcept {
+		return items_[slot_of(iLink)].generation ==
+		       ((iLink & constants::k_spoiler_mask) >> constants::k_spoiler_shift);
+	}
+	/**! Mark slot iIndex live and stamp its generation on iLink */
+	inline size_type make_current(size_type iIndex, size_type iLink) noexcept {
+		if constexpr (k_generational) {
+			auto& generation = items_[iIndex].generation;
+			generation &= ~std::uint8_t(k_free_generation);
+			iLink |= static_cast<size_type>(size_type(generation)
+			                                << constants::k_spoiler_shift);
+		}
+		return iLink;
+	}
+	/**! Next generation of slot iIndex, marked free */
+	inline void retire(size_type iIndex) noexcept {
+		if constexpr (k_generational) {
+			auto& generation = items_[iIndex].generation;
+			generation       = static_cast<std::uint8_t>(
+			    ((generation + 1) & constants::k_spoiler_max) | k_free_generation);
+		}
+	}
+
+	template <typename... ColdArgs>
+	inline link insert_split(Ty const& iObject, ColdArgs&&... iCold) {
+		size_type index = first_free_index_;
+		if (index == constants::k_null) {
+			if (out_of_links())
+				return link();
+			index = static_cast<size_type>(size_);
+			push_back(iObject);
+#ifdef CPPTABLES_DEBUG
+			spoilers.emplace_back(generation_of(index));
+#endif
+		} else {
+			first_free_index_ = items_[index].get_integer();
+			if (first_free_index_ == constants::k_null)
+				clear_usage();
+			items_[index].construct(iObject);
+			set_usage<true>(index);
+		}
+		cold_.construct(index, std::forward<ColdArgs>(iCold)...);
+		size_type link_numbr = index;
+#ifdef CPPTABLES_DEBUG
+		link_numbr = index_t(index, spoilers[index]).value();
+#endif
+		link_numbr = make_current(index, link_numbr);
+		valid_count_++;
+		return link(link_numbr);
+	}
+
 	void push_back(Ty const& x) {
 		if (capacity_ < size_ + 1)
-			unchecked_reserve(size_ + std::max<size_type>(size_ >> 1, 1));
+			grow();
+		new_generation(size_);
 		items_[size_++].construct(x);
 	}
 
 	template <class... Args> void emplace_back(Args&&... args) {
 		if (capacity_ < size_ + 1)
-			unchecked_reserve(size_ + std::max<size_type>(size_ >> 1, 1));
+			grow();
+		new_generation(size_);
 		items_[size_++].construct(std::forward<Args>(args)...);
 	}
 
-	template <typename Lambda, typename Type>
-	inline static void for_each(Type& iCont, Lambda&& iLambda) {
-		size_type begin = 0;
-		size_type end   = iCont.size_;
-		if (begin < iCont.usage_.size()) {
-			for (; begin < end; ++begin) {
-				if (iCont.is_valid(begin))
-					std::forward<Lambda>(iLambda)(iCont.items_[begin].get());
+	/**! Generation of a new slot, the one it had if it was dropped before */
+	inline void new_generation(size_type iIndex) noexcept {
+		if constexpr (k_generational) {
+			items_[iIndex].generation = iIndex < dropped_generations_.size()
+			                                ? dropped_generations_[iIndex]
+			                                : std::uint8_t(0);
+		}
+	}
+	/**! Generation links to slot iIndex carry, 0 without generations */
+	inline std::uint8_t generation_of(size_type iIndex) const noexcept {
+		if constexpr (k_generational)
+			return items_[iIndex].generation & ~std::uint8_t(k_free_generation);
+		else
+			return 0;
+	}
+	/**!
+	 * Keep the next generation of slots [iBegin, iEnd) as they leave the
+	 * table, a slot grown back there then does not revive old links
+	 */
+	void drop_generations(size_type iBegin, size_type iEnd) {
+		if constexpr (k_generational) {
+			if (dropped_generations_.size() < iEnd)
+				dropped_generations_.resize(iEnd, 0);
+			for (size_type i = iBegin; i < iEnd; ++i) {
+				if (!(items_[i].generation & k_free_generation))
+					retire(i);
+				dropped_generations_[i] = generation_of(i);
 			}
+		}
+	}
+	/**!
+	 * Generational links carry the slot in the k_index_mask bits only, the
+	 * table takes no slot past them
+	 */
+	inline bool out_of_links() const noexcept {
+		return k_generational && size_ >= constants::k_index_mask;
+	}
+
+	void move_slot(size_type iFrom, size_type iTo, link_remap<link>& oRemap) {
+		items_[iTo].construct(std::move(items_[iFrom].get()));
+		items_[iFrom].destroy();
+		cold_.move(iFrom, iTo);
+		set_usage<true>(iTo);
+		set_usage<false>(iFrom);
+		link from(iFrom);
+		link to(iTo);
+#ifdef CPPTABLES_DEBUG
+		from = link(index_t(iFrom, spoilers[iFrom]).value());
+		to   = link(index_t(iTo, spoilers[iTo]).value());
+		spoilers[iFrom] = (spoilers[iFrom] + 1) & constants::k_spoiler_max;
+#endif
+		from = link(make_current(iFrom, from.value()));
+		to   = link(make_current(iTo, to.value()));
+		retire(iFrom);
+		set_link(items_[iTo].get(), to);
+		oRemap.add(from, to);
+	}
+	/**!
+	 * Collect the free slots from the usage map in compact_holes_ and relink
+	 * the free list in slot order, so compaction fills the lowest hole by
+	 * popping the head
+	 */
+	void sort_free_list() {
+		compact_holes_.clear();
+		compact_lo_ = 0;
+		for (size_type w = 0, words = static_cast<size_type>(usage_.size());
+		     w < words; ++w) {
+			for (usage_word bits = usage_[w]; bits; bits &= bits - 1)
+				compact_holes_.push_back(
+				    (w << k_usage_shift) +
+				    static_cast<size_type>(std::countr_zero(bits)));
+		}
+		for (std::size_t i = 0, n = compact_holes_.size(); i < n; ++i)
+			items_[compact_holes_[i]].set_integer(
+			    i + 1 < n ? compact_holes_[i + 1] : constants::k_null);
+		first_free_index_ =
+		    compact_holes_.empty() ? constants::k_null : compact_holes_[0];
+	}
+	/**!
+	 * Drop the slots from iEnd on, all free, and cut the holes among them
+	 * off the end of the sorted free list
+	 */
+	void trim(size_type iEnd) {
+		drop_generations(iEnd, size_);
+		size_       = iEnd;
+		size_type words = (iEnd + k_usage_mask) >> k_usage_shift;
+		if (usage_.size() > words) {
+			usage_.resize(words);
+			if constexpr (k_summary)
+				summary_.resize(words ? ((words - 1) >> k_usage_shift) + 1 : 0);
+		}
+		if (words && (iEnd & k_usage_mask)) {
+			// slots past size_ read as valid, as past the end of the map
+			usage_[words - 1] &= k_usage_all >> (64 - (iEnd & k_usage_mask));
+			if constexpr (k_summary)
+				summary_[(words - 1) >> k_usage_shift] |=
+				    usage_word(1) << ((words - 1) & k_usage_mask);
+		}
+		if constexpr (k_summary) {
+			if (!summary_.empty() && (words & k_usage_mask))
+				summary_.back() &= k_usage_all >> (64 - (words & k_usage_mask));
+		}
+#ifdef CPPTABLES_DEBUG
+		spoilers.resize(iEnd);
+#endif
+		while (compact_holes_.size() > compact_lo_ &&
+		       compact_holes_.back() >= iEnd)
+			compact_holes_.pop_back();
+		if (compact_lo_ < compact_holes_.size()) {
+			items_[compact_holes_.back()].set_integer(constants::k_null);
+			first_free_index_ = compact_holes_[compact_lo_];
 		} else {
-			for (; begin < end; ++begin) {
-				std::forward<Lambda>(iLambda)(iCont.items_[begin].get());
+			first_free_index_ = constants::k_null;
+			clear_usage();
+		}
+		compact_head_  = first_free_index_;
+		compact_range_ = range();
+	}
+	/**! Give back the storage past size_ */
+	void shrink_storage() {
+		if constexpr (k_paged) {
+			block_allocator allocator(*this);
+			items_.shrink(allocator, size_);
+			cold_.shrink(*this, size_);
+			capacity_ = items_.capacity();
+		} else if (capacity_ > size_) {
+			if (size_)
+				unchecked_reserve(size_);
+			else {
+				deallocate();
+				cold_.deallocate(*this);
+				items_    = nullptr;
+				capacity_ = 0;
 			}
 		}
 	}
-	template <typename Lambda, typename Type>
-	inline static void for_each(Type& iCont, size_type iBegin, size_type iEnd,
-	                            Lambda&& iLambda) {
-		size_type begin = iBegin;
-		size_type end   = iEnd;
-		if (begin < iCont.usage_.size()) {
-			for (; begin < end; ++begin) {
-				if (iCont.is_valid(begin))
-					std::forward<Lambda>(iLambda)(iCont.items_[begin].get());
+	/**! First usage word at or after iW with a live slot, usage_.size() if none */
+	size_type next_live_word(size_type iW) const {
+		size_type words = static_cast<size_type>(usage_.size());
+		if constexpr (k_summary) {
+			size_type s = iW >> k_usage_shift;
+			if (s >= summary_.size())
+				return words;
+			usage_word bits = summary_[s] & (k_usage_all << (iW & k_usage_mask));
+			while (!bits) {
+				if (++s == summary_.size())
+					return words;
+				bits = summary_[s];
 			}
+			return (s << k_usage_shift) +
+			       static_cast<size_type>(std::countr_zero(bits));
 		} else {
-			for (; begin < end; ++begin) {
-				std::forward<Lambda>(iLambda)(iCont.items_[begin].get());
+			return details::scan_words<size_type>{usage_}.next(iW);
+		}
+	}
+	/**! Last usage word before iW with a live slot, k_null if none */
+	size_type prev_live_word(size_type iW) const {
+		if constexpr (k_summary) {
+			if (iW == 0)
+				return constants::k_null;
+			--iW;
+			size_type s = iW >> k_usage_shift;
+			usage_word bits =
+			    summary_[s] & (k_usage_all >> (k_usage_mask - (iW & k_usage_mask)));
+			while (!bits) {
+				if (s == 0)
+					return constants::k_null;
+				bits = summary_[--s];
 			}
+			return (s << k_usage_shift) + k_usage_mask -
+			       static_cast<size_type>(std::countl_zero(bits));
+		} else {
+			return details::scan_words<size_type>{usage_}.prev(iW);
+		}
+	}
+	/**! Skips free words through the summary when there is one */
+	struct usage_skip {
+		this_type const& table;
+		size_type next(size_type iW) const { return table.next_live_word(iW); }
+		size_type prev(size_type iW) const { return table.prev_live_word(iW); }
+	};
+	/**! Extend the usage map with fully valid words */
+	void grow_usage(size_type iWords) {
+		size_type first = static_cast<size_type>(usage_.size());
+		usage_.resize(iWords, 0);
+		if constexpr (k_summary) {
+			summary_.resize(((iWords - 1) >> k_usage_shift) + 1, 0);
+			for (size_type w = first; w < iWords; ++w)
+				summary_[w >> k_usage_shift] |= usage_word(1) << (w & k_usage_mask);
 		}
 	}
+	void clear_usage() {
+		usage_.clear();
+		if constexpr (k_summary)
+			summary_.clear();
+	}
+
+	/**! First free slot at or after iIt, range() if there is none */
+	size_type next_free(size_type iIt) const {
+		return std::min(details::next_free(usage_, iIt), size_);
+	}
+	/**! First valid slot at or after iIt, range() if there is none */
+	size_type next_valid(size_type iIt) const {
+		return std::min(details::next_live(usage_, iIt, usage_skip{*this}), size_);
+	}
+	/**! Last valid slot at or before iIt, k_null if there is none */
+	size_type prev_valid(size_type iIt) const {
+		return details::prev_live(usage_, iIt, usage_skip{*this});
+	}
+
+	template <typename Lambda, typename Type>
+	inline static void for_each_run(Type& iCont, size_type iBegin,
+	                                size_type iEnd, Lambda&& iLambda) {
+		static_assert(details::is_array_layout_v<block_type, Ty>,
+		              "Runs need the slots laid out as an array of Ty");
+		details::for_each_live_run(
+		    iCont.usage_, iBegin, iEnd, usage_skip{iCont},
+		    [&](size_type iFirst, size_type iLast) {
+			    if constexpr (k_paged) {
+				    // a run spanning pages is handed out a page at a time
+				    while (iFirst < iLast) {
+					    size_type stop =
+					        std::min(iLast, item_storage::page_end(iFirst));
+					    std::forward<Lambda>(iLambda)(
+					        std::span(&iCont.items_[iFirst].get(), stop - iFirst));
+					    iFirst = stop;
+				    }
+			    } else {
+				    std::forward<Lambda>(iLambda)(
+				        std::span(&iCont.items_[iFirst].get(), iLast - iFirst));
+			    }
+		    });
+	}
+	template <typename Lambda, typename Type>
+	inline static void for_each(Type& iCont, Lambda&& iLambda) {
+		for_each(iCont, 0, iCont.size_, std::forward<Lambda>(iLambda));
+	}
+	template <typename Lambda, typename Type>
+	inline static void for_each(Type& iCont, size_type iBegin, size_type iEnd,
+	                            Lambda&& iLambda) {
+		for_each_index(iCont, iBegin, iEnd, [&](size_type i) {
+			std::forward<Lambda>(iLambda)(iCont.items_[i].get());
+		});
+	}
+	/**!
+	 * Lambda called with the slot of each live object in [iBegin, iEnd).
+	 * Scans the usage map a word at a time, a fully free word costs a single
+	 * compare and live slots are found with countr_zero
+	 */
+	template <typename Lambda, typename Type>
+	inline static void for_each_index(Type& iCont, size_type iBegin,
+	                                  size_type iEnd, Lambda&& iLambda) {
+		details::for_each_live(iCont.usage_, iBegin, iEnd, usage_skip{iCont},
+		                       std::forward<Lambda>(iLambda));
+	}
 	inline dbpointer allocate(size_type n) {
-		return reinterpret_cast<dbpointer>(Allocator::allocate(n));
+		if constexpr (k_generational)
+			return block_allocator(*this).allocate(n);
+		else
+			return reinterpret_cast<dbpointer>(Allocator::allocate(n));
 	}
 	inline void deallocate() {
-		Allocator::deallocate(reinterpret_cast<Ty*>(items_), capacity_);
+		if constexpr (k_paged) {
+			block_allocator allocator(*this);
+			items_.deallocate(allocator);
+		} else if constexpr (k_generational) {
+			if (items_)
+				block_allocator(*this).deallocate(items_, capacity_);
+		} else {
+			Allocator::deallocate(reinterpret_cast<Ty*>(items_), capacity_);
+		}
 	}
 
 	inline void destroy_and_deallocate() {
@@ -410,37 +986,65 @@ private:
 					items_[i].get().~Ty();
 			}
 		}
+		if constexpr (k_cold) {
+			for (size_type i = 0; i < size_; ++i) {
+				if (is_valid(i))
+					cold_.destroy(i);
+			}
+		}
 		deallocate();
+		cold_.deallocate(*this);
 		capacity_    = 0;
 		size_        = 0;
 		valid_count_ = 0;
-		usage_.clear();
+		clear_usage();
 	}
 
+	/**! Room for one more slot, paged storage only ever adds a page */
+	inline void grow() {
+		if constexpr (k_paged)
+			unchecked_reserve(size_ + 1);
+		else
+			unchecked_reserve(Growth::grow(size_, size_ + 1, sizeof(Ty)));
+	}
 	inline void unchecked_reserve(size_type n) {
-		dbpointer d = allocate(n);
-		if (std::is_trivially_copyable_v<Ty>)
-			std::memcpy(d, items_, size_ * sizeof(Ty));
-		else {
-			size_type mcopy = std::min<size_type>(size_, n);
-			for (size_type i = 0; i < mcopy; ++i) {
-				if (is_valid(i)) {
-					d[i].construct(std::move(items_[i].get()));
-					if constexpr (!std::is_trivially_destructible_v<Ty>) {
-						items_[i].get().~Ty();
+		cold_.reserve(*this, size_, n,
+		              [this](size_type i) { return is_valid(i); });
+		if constexpr (k_paged) {
+			// pages are only added, live objects stay where they are
+			block_allocator allocator(*this);
+			items_.reserve(allocator, n);
+			capacity_ = items_.capacity();
+		} else {
+			dbpointer d = allocate(n);
+			if (std::is_trivially_copyable_v<Ty>) {
+				if (size_)
+					std::memcpy(d, items_, size_ * sizeof(block_type));
+			} else {
+				size_type mcopy = std::min<size_type>(size_, n);
+				for (size_type i = 0; i < mcopy; ++i) {
+					if constexpr (k_generational)
+						d[i].generation = items_[i].generation;
+					if (is_valid(i)) {
+						d[i].construct(std::move(items_[i].get()));
+						if constexpr (!std::is_trivially_destructible_v<Ty>) {
+							items_[i].get().~Ty();
+						}
+					} else {
+						d[i].set_integer(items_[i].get_integer());
 					}
-				} else {
-					d[i].set_integer(items_[i].get_integer());
 				}
 			}
+			deallocate();
+			items_    = d;
+			capacity_ = n;
 		}
-		deallocate();
-		items_    = d;
-		capacity_ = n;
 	}
 
-	data_block* items_ = nullptr;
+	item_storage items_ = {};
+	[[no_unique_address]] cold_storage cold_;
 	usage_map usage_;
+	usage_map summary_;
 	size_type size_             = 0;
 	size_type capacity_         = 0;
 	size_type valid_count_      = 0;
@@ -448,6 +1052,15 @@ private:
 #ifdef CPPTABLES_DEBUG
 	std::vector<std::uint8_t> spoilers;
 #endif
+	// compact_step state: free slots sorted, [compact_lo_, end) still free,
+	// valid while the free list head and range() are as the last step left.
+	// Erases reset compact_range_, they can bring that head back.
+	std::vector<size_type> compact_holes_;
+	std::size_t compact_lo_  = 0;
+	size_type compact_head_  = constants::k_null;
+	size_type compact_range_ = 0;
+	// generations of the slots dropped past size_ by trim and clear
+	[[no_unique_address]] generation_map dropped_generations_;
 };
 } // namespace details
 } // namespace cpptables
\ No newline at end of file
@@ -113,7 +113,10 @@ struct alignas(alignof(Ty)) storage_with_backref {
 	Ty& get() { return object(); }
 
 	// Note: Alignmen is handled by allocator
-	std::aligned_storage_t<sizeof(Ty)> storage;
+	// Ty's own alignment rather than the aligned_storage default, which pads
+	// small types to 16 bytes: the slot keeps the size of Ty and a run of
+	// slots can be handed out as a Ty array, see is_array_layout_v
+	std::aligned_storage_t<sizeof(Ty), alignof(Ty)> storage;
 };
 } // namespace details
 } // namespace cpptables
@@ -1,6 +1,8 @@
 #pragma once
 #include "basic_types.hpp"
+#include "concurrent_sparse_table.hpp"
 #include "packed_table_with_indirection.hpp"
+#include "soa_table.hpp"
 #include "sparse_table_of_pointers.hpp"
 #include "sparse_table_with_backref.hpp"
 #include "sparse_table_with_no_iter.hpp"
@@ -188,4 +190,367 @@ public:
 template <typename Ty, typename Allocator = std::allocator<Ty>>
 using tbl_sparse_vmap = table<tv_sparse_vmap, Ty, 0, std::uint32_t, Allocator>;
 
+constexpr auto tv_sparse_vmap_sum_br =
+    tags_v<tags::sparse, tags::validmap, tags::summary, tags::backref>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_vmap_sum_br, Ty, BackrefMember, SizeType, Allocator>
+    : public details::sparse_table_with_validmap<
+          Ty, SizeType, Allocator, with_backref<BackrefMember>,
+          std::false_type, std::true_type> {
+public:
+	enum : unsigned { tags = tv_sparse_vmap_sum_br };
+};
+
+template <typename Ty, auto BackrefMember,
+          typename Allocator = std::allocator<Ty>>
+using tbl_sparse_vmap_sum_br =
+    table<tv_sparse_vmap_sum_br, Ty, BackrefMember, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_vmap_sum =
+    tags_v<tags::sparse, tags::validmap, tags::summary>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_vmap_sum, Ty, BackrefMember, SizeType, Allocator>
+    : public details::sparse_table_with_validmap<
+          Ty, SizeType, Allocator, no_backref, std::false_type,
+          std::true_type> {
+public:
+	enum : unsigned { tags = tv_sparse_vmap_sum };
+};
+
+template <typename Ty, typename Allocator = std::allocator<Ty>>
+using tbl_sparse_vmap_sum =
+    table<tv_sparse_vmap_sum, Ty, 0, std::uint32_t, Allocator>;
+
+// Paged variants: objects sit in fixed pages and never move when the table
+// grows
+constexpr auto tv_sparse_no_iter_pg_br =
+    tags_v<tags::sparse, tags::no_iter, tags::paged, tags::backref>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_no_iter_pg_br, Ty, BackrefMember, SizeType, Allocator>
+    : public details::sparse_table_with_no_iter<
+          Ty, SizeType, Allocator, with_backref<BackrefMember>, paged<>> {
+public:
+	enum : unsigned { tags = tv_sparse_no_iter_pg_br };
+};
+
+template <typename Ty, auto BackrefMember,
+          typename Allocator = std::allocator<Ty>>
+using tbl_sparse_no_iter_pg_br =
+    table<tv_sparse_no_iter_pg_br, Ty, BackrefMember, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_no_iter_pg =
+    tags_v<tags::sparse, tags::no_iter, tags::paged>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_no_iter_pg, Ty, BackrefMember, SizeType, Allocator>
+    : public details::sparse_table_with_no_iter<
+          Ty, SizeType, Allocator, no_backref, paged<>> {
+public:
+	enum : unsigned { tags = tv_sparse_no_iter_pg };
+};
+
+template <typename Ty, typename Allocator = std::allocator<Ty>>
+using tbl_sparse_no_iter_pg =
+    table<tv_sparse_no_iter_pg, Ty, 0, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_sfree_pg_br =
+    tags_v<tags::sparse, tags::sortedfree, tags::paged, tags::backref>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_sfree_pg_br, Ty, BackrefMember, SizeType, Allocator>
+    : public details::sparse_table_with_sortedfree<
+          Ty, SizeType, Allocator, with_backref<BackrefMember>, paged<>> {
+public:
+	enum : unsigned { tags = tv_sparse_sfree_pg_br };
+};
+
+template <typename Ty, auto BackrefMember,
+          typename Allocator = std::allocator<Ty>>
+using tbl_sparse_sfree_pg_br =
+    table<tv_sparse_sfree_pg_br, Ty, BackrefMember, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_sfree_pg =
+    tags_v<tags::sparse, tags::sortedfree, tags::paged>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_sfree_pg, Ty, BackrefMember, SizeType, Allocator>
+    : public details::sparse_table_with_sortedfree<
+          Ty, SizeType, Allocator, no_backref, paged<>> {
+public:
+	enum : unsigned { tags = tv_sparse_sfree_pg };
+};
+
+template <typename Ty, typename Allocator = std::allocator<Ty>>
+using tbl_sparse_sfree_pg =
+    table<tv_sparse_sfree_pg, Ty, 0, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_vmap_pg_br =
+    tags_v<tags::sparse, tags::validmap, tags::paged, tags::backref>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_vmap_pg_br, Ty, BackrefMember, SizeType, Allocator>
+    : public details::sparse_table_with_validmap<
+          Ty, SizeType, Allocator, with_backref<BackrefMember>, paged<>> {
+public:
+	enum : unsigned { tags = tv_sparse_vmap_pg_br };
+};
+
+template <typename Ty, auto BackrefMember,
+          typename Allocator = std::allocator<Ty>>
+using tbl_sparse_vmap_pg_br =
+    table<tv_sparse_vmap_pg_br, Ty, BackrefMember, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_vmap_pg =
+    tags_v<tags::sparse, tags::validmap, tags::paged>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_vmap_pg, Ty, BackrefMember, SizeType, Allocator>
+    : public details::sparse_table_with_validmap<
+          Ty, SizeType, Allocator, no_backref, paged<>> {
+public:
+	enum : unsigned { tags = tv_sparse_vmap_pg };
+};
+
+template <typename Ty, typename Allocator = std::allocator<Ty>>
+using tbl_sparse_vmap_pg =
+    table<tv_sparse_vmap_pg, Ty, 0, std::uint32_t, Allocator>;
+
+constexpr auto tv_packed_gen = tags_v<tags::packed, tags::generational>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_packed_gen, Ty, BackrefMember, SizeType, Allocator>
+    : public details::packed_table_with_indirection<
+          Ty, SizeType, Allocator, no_backref, std::true_type, void,
+          with_generations> {
+public:
+	enum : unsigned { tags = tv_packed_gen };
+};
+
+template <typename Ty, typename Allocator = std::allocator<Ty>>
+using tbl_packed_gen = table<tv_packed_gen, Ty, 0, std::uint32_t, Allocator>;
+
+constexpr auto tv_packed_gen_br =
+    tags_v<tags::packed, tags::backref, tags::generational>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_packed_gen_br, Ty, BackrefMember, SizeType, Allocator>
+    : public details::packed_table_with_indirection<
+          Ty, SizeType, Allocator, with_backref<BackrefMember>,
+          std::true_type, void, with_generations> {
+public:
+	enum : unsigned { tags = tv_packed_gen_br };
+};
+
+template <typename Ty, auto BackrefMember,
+          typename Allocator = std::allocator<Ty>>
+using tbl_packed_gen_br =
+    table<tv_packed_gen_br, Ty, BackrefMember, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_vmap_gen =
+    tags_v<tags::sparse, tags::validmap, tags::generational>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_vmap_gen, Ty, BackrefMember, SizeType, Allocator>
+    : public details::sparse_table_with_validmap<
+          Ty, SizeType, Allocator, no_backref, std::false_type,
+          std::false_type, growth_policy_t<Ty>, void, with_generations> {
+public:
+	enum : unsigned { tags = tv_sparse_vmap_gen };
+};
+
+template <typename Ty, typename Allocator = std::allocator<Ty>>
+using tbl_sparse_vmap_gen =
+    table<tv_sparse_vmap_gen, Ty, 0, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_vmap_gen_br =
+    tags_v<tags::sparse, tags::validmap, tags::backref, tags::generational>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_vmap_gen_br, Ty, BackrefMember, SizeType, Allocator>
+    : public details::sparse_table_with_validmap<
+          Ty, SizeType, Allocator, with_backref<BackrefMember>,
+          std::false_type, std::false_type, growth_policy_t<Ty>, void,
+          with_generations> {
+public:
+	enum : unsigned { tags = tv_sparse_vmap_gen_br };
+};
+
+template <typename Ty, auto BackrefMember,
+          typename Allocator = std::allocator<Ty>>
+using tbl_sparse_vmap_gen_br =
+    table<tv_sparse_vmap_gen_br, Ty, BackrefMember, std::uint32_t, Allocator>;
+
+constexpr auto tv_packed_hc = tags_v<tags::packed, tags::hot_cold>;
+
+/**!
+ * Packed table of the hot part Ty, the Cold part of each object lives in a
+ * parallel vector. for_each walks Ty only.
+ */
+template <typename Ty, typename Cold, typename Allocator = std::allocator<Ty>>
+class tbl_packed_hc
+    : public details::packed_table_with_indirection<
+          Ty, std::uint32_t, Allocator, no_backref, std::true_type, Cold> {
+public:
+	enum : unsigned { tags = tv_packed_hc };
+};
+
+constexpr auto tv_sparse_vmap_hc =
+    tags_v<tags::sparse, tags::validmap, tags::hot_cold>;
+
+/**!
+ * Validmap table of the hot part Ty, the Cold part of each object lives in
+ * a parallel array indexed by the same slot. for_each walks Ty only.
+ */
+template <typename Ty, typename Cold, typename Allocator = std::allocator<Ty>>
+class tbl_sparse_vmap_hc
+    : public details::sparse_table_with_validmap<
+          Ty, std::uint32_t, Allocator, no_backref, std::false_type,
+          std::false_type, growth_policy_t<Ty>, Cold> {
+public:
+	enum : unsigned { tags = tv_sparse_vmap_hc };
+};
+
+constexpr auto tv_sparse_vmap_pg_hc =
+    tags_v<tags::sparse, tags::validmap, tags::paged, tags::hot_cold>;
+
+template <typename Ty, typename Cold, typename Allocator = std::allocator<Ty>>
+class tbl_sparse_vmap_pg_hc
+    : public details::sparse_table_with_validmap<
+          Ty, std::uint32_t, Allocator, no_backref, paged<>, std::false_type,
+          growth_policy_t<Ty>, Cold> {
+public:
+	enum : unsigned { tags = tv_sparse_vmap_pg_hc };
+};
+
+constexpr auto tv_sparse_conc = tags_v<tags::sparse, tags::concurrent>;
+
+/**!
+ * Sparse table taking insert, emplace and erase from many threads without a
+ * lock, sized for at most the max size passed to the constructor
+ */
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_conc, Ty, BackrefMember, SizeType, Allocator>
+    : public details::concurrent_sparse_table<Ty, SizeType, Allocator,
+                                              no_backref> {
+	using base_type = details::concurrent_sparse_table<Ty, SizeType, Allocator,
+	                                                   no_backref>;
+
+public:
+	using base_type::base_type;
+	enum : unsigned { tags = tv_sparse_conc };
+};
+
+template <typename Ty, typename Allocator = std::allocator<Ty>>
+using tbl_sparse_conc = table<tv_sparse_conc, Ty, 0, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_conc_br =
+    tags_v<tags::sparse, tags::concurrent, tags::backref>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_conc_br, Ty, BackrefMember, SizeType, Allocator>
+    : public details::concurrent_sparse_table<Ty, SizeType, Allocator,
+                                              with_backref<BackrefMember>> {
+	using base_type =
+	    details::concurrent_sparse_table<Ty, SizeType, Allocator,
+	                                     with_backref<BackrefMember>>;
+
+public:
+	using base_type::base_type;
+	enum : unsigned { tags = tv_sparse_conc_br };
+};
+
+template <typename Ty, auto BackrefMember,
+          typename Allocator = std::allocator<Ty>>
+using tbl_sparse_conc_br =
+    table<tv_sparse_conc_br, Ty, BackrefMember, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_conc_ebr =
+    tags_v<tags::sparse, tags::concurrent, tags::epoch>;
+
+/**!
+ * Concurrent sparse table that reclaims erased objects by epochs, readers
+ * pinned through make_reader() never see a destroyed object or reused slot
+ */
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_conc_ebr, Ty, BackrefMember, SizeType, Allocator>
+    : public details::concurrent_sparse_table<Ty, SizeType, Allocator,
+                                              no_backref, with_epochs> {
+	using base_type = details::concurrent_sparse_table<Ty, SizeType, Allocator,
+	                                                   no_backref, with_epochs>;
+
+public:
+	using base_type::base_type;
+	enum : unsigned { tags = tv_sparse_conc_ebr };
+};
+
+template <typename Ty, typename Allocator = std::allocator<Ty>>
+using tbl_sparse_conc_ebr =
+    table<tv_sparse_conc_ebr, Ty, 0, std::uint32_t, Allocator>;
+
+constexpr auto tv_sparse_conc_ebr_br =
+    tags_v<tags::sparse, tags::concurrent, tags::epoch, tags::backref>;
+
+template <typename Ty, auto BackrefMember, typename SizeType,
+          typename Allocator>
+class table<tv_sparse_conc_ebr_br, Ty, BackrefMember, SizeType, Allocator>
+    : public details::concurrent_sparse_table<
+          Ty, SizeType, Allocator, with_backref<BackrefMember>, with_epochs> {
+	using base_type =
+	    details::concurrent_sparse_table<Ty, SizeType, Allocator,
+	                                     with_backref<BackrefMember>,
+	                                     with_epochs>;
+
+public:
+	using base_type::base_type;
+	enum : unsigned { tags = tv_sparse_conc_ebr_br };
+};
+
+template <typename Ty, auto BackrefMember,
+          typename Allocator = std::allocator<Ty>>
+using tbl_sparse_conc_ebr_br =
+    table<tv_sparse_conc_ebr_br, Ty, BackrefMember, std::uint32_t, Allocator>;
+
+constexpr auto tv_soa = tags_v<tags::soa, tags::validmap>;
+
+/**!
+ * Struct of arrays table over the given column types, links are typed by
+ * std::tuple<Columns...>
+ */
+template <typename... Columns>
+class tbl_soa
+    : public details::soa_table<std::tuple<Columns...>, std::uint32_t,
+                                std::allocator<std::byte>, Columns...> {
+public:
+	enum : unsigned { tags = tv_soa };
+};
+
+/**!
+ * Struct of arrays table holding the listed members of Ty, links are
+ * link<Ty> like every other table of Ty
+ */
+template <typename Ty, auto... Members>
+class tbl_soa_of : public details::soa_table_of<Ty, std::uint32_t,
+                                                std::allocator<Ty>, Members...> {
+public:
+	enum : unsigned { tags = tv_soa };
+};
+
 } // namespace cpptables
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cpptables {
+
+/**!
+ * Minimal fork-join pool used by parallel_for_each.
+ *
+ * An executor is any type exposing:
+ *   std::size_t concurrency() const;
+ *   void execute(std::size_t iCount, Fn&& iFn); // calls iFn(i) for i in
+ *                                               // [0, iCount), returns when
+ *                                               // all calls are done
+ * so a job system can be plugged in place of this pool.
+ */
+class thread_pool {
+	struct job {
+		void const* context = nullptr;
+		void (*call)(void const*, std::size_t) = nullptr;
+		std::atomic<std::size_t> next{0};
+		std::size_t count = 0;
+		std::uint32_t users = 0;
+	};
+
+public:
+	/**! iWorkers threads are spawned, the calling thread also takes tasks */
+	explicit thread_pool(std::size_t iWorkers = default_workers()) {
+		workers_.reserve(iWorkers);
+		for (std::size_t i = 0; i < iWorkers; ++i)
+			workers_.emplace_back([this]() { work(); });
+	}
+	thread_pool(thread_pool const&) = delete;
+	thread_pool& operator=(thread_pool const&) = delete;
+
+	~thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (auto& w : workers_)
+			w.join();
+	}
+
+	/**! Number of threads that run tasks, including the caller */
+	std::size_t concurrency() const noexcept { return workers_.size() + 1; }
+
+	/**!
+	 * Calls iFn(i) for each i in [0, iCount) and blocks until all are done.
+	 * Calls made from inside a task run inline.
+	 */
+	template <typename Fn> void execute(std::size_t iCount, Fn&& iFn) {
+		if (iCount == 0)
+			return;
+		if (iCount == 1 || workers_.empty() || in_task_) {
+			for (std::size_t i = 0; i < iCount; ++i)
+				iFn(i);
+			return;
+		}
+
+		std::lock_guard<std::mutex> submit(submit_);
+		job j;
+		j.context = &iFn;
+		j.call    = [](void const* iContext, std::size_t i) {
+			using fn_t = std::remove_reference_t<Fn>;
+			(*static_cast<fn_t*>(const_cast<void*>(iContext)))(i);
+		};
+		j.count = iCount;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			job_ = &j;
+			++generation_;
+		}
+		wake_.notify_all();
+		run(j);
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		// nobody attaches once job_ is reset, wait for those already running
+		job_ = nullptr;
+		done_.wait(lock, [&j]() { return j.users == 0; });
+	}
+
+	static std::size_t default_workers() {
+		std::size_t hw = std::thread::hardware_concurrency();
+		return hw > 1 ? hw - 1 : 0;
+	}
+
+private:
+	static void run(job& iJob) {
+		in_task_ = true;
+		for (std::size_t i = iJob.next.fetch_add(1, std::memory_order_relaxed);
+		     i < iJob.count;
+		     i = iJob.next.fetch_add(1, std::memory_order_relaxed))
+			iJob.call(iJob.context, i);
+		in_task_ = false;
+	}
+
+	void work() {
+		std::uint64_t seen = 0;
+		std::unique_lock<std::mutex> lock(mutex_);
+		for (;;) {
+			wake_.wait(lock,
+			           [&]() { return stop_ || (job_ && seen != generation_); });
+			if (stop_)
+				return;
+			seen   = generation_;
+			job* j = job_;
+			j->users++;
+			lock.unlock();
+			run(*j);
+			lock.lock();
+			if (--j->users == 0)
+				done_.notify_all();
+		}
+	}
+
+	std::vector<std::thread> workers_;
+	std::mutex submit_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	job* job_                 = nullptr;
+	std::uint64_t generation_ = 0;
+	bool stop_                = false;
+
+	static inline thread_local bool in_task_ = false;
+};
+
+/**! Process wide pool used when no executor is given */
+inline thread_pool& default_thread_pool() {
+	static thread_pool pool;
+	return pool;
+}
+
+} // namespace cpptables
@@ -0,0 +1,199 @@
+#pragma once
+#include "parallel.hpp"
+#include <chrono>
+#include <memory>
+#include <span>
+
+namespace cpptables {
+
+/**!
+ * Per worker counters of the last work_stealing_scheduler::run
+ */
+struct worker_stats {
+	std::uint64_t tasks   = 0; // chunks executed
+	std::uint64_t steals  = 0; // chunks taken from another worker
+	std::uint64_t slots   = 0; // slots of range() covered
+	std::uint64_t busy_ns = 0; // time spent inside table lambdas
+	std::uint64_t wall_ns = 0; // duration of the whole run
+
+	/**! Fraction of the run this worker spent doing table work */
+	double utilization() const noexcept {
+		return wall_ns ? static_cast<double>(busy_ns) /
+		                     static_cast<double>(wall_ns)
+		               : 0.0;
+	}
+};
+
+/**!
+ * Iterates many tables at once. Every added table has its range() cut in
+ * chunks that are dealt to per worker deques, a worker drains its own
+ * deque front to back and steals from the back of the others when it runs
+ * dry. Chunks run through the table's ranged for_each.
+ *
+ * Workers are the threads of an executor (see thread_pool), so the
+ * scheduler carries no threads of its own.
+ */
+class work_stealing_scheduler {
+	struct binding_base {
+		virtual ~binding_base()                               = default;
+		virtual void run(std::size_t iBeg, std::size_t iEnd) = 0;
+	};
+
+	template <typename Table, typename Lambda>
+	struct binding : binding_base {
+		binding(Table& iTable, Lambda&& iLambda)
+		    : table(iTable), lambda(std::forward<Lambda>(iLambda)) {}
+		void run(std::size_t iBeg, std::size_t iEnd) override {
+			using size_type = typename std::remove_const_t<Table>::size_type;
+			table.for_each(static_cast<size_type>(iBeg),
+			               static_cast<size_type>(iEnd), lambda);
+		}
+		Table& table;
+		std::decay_t<Lambda> lambda;
+	};
+
+	struct chunk {
+		binding_base* owner = nullptr;
+		std::size_t beg     = 0;
+		std::size_t end     = 0;
+	};
+
+	struct deque {
+		bool pop_front(chunk& oChunk) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (head == chunks.size())
+				return false;
+			oChunk = chunks[head++];
+			return true;
+		}
+		bool pop_back(chunk& oChunk) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (head == chunks.size())
+				return false;
+			oChunk = chunks.back();
+			chunks.pop_back();
+			return true;
+		}
+		std::mutex mutex;
+		std::vector<chunk> chunks;
+		std::size_t head = 0;
+	};
+
+public:
+	/**!
+	 * Queue iLambda over every live object of iTable for the next run.
+	 * iChunk is the number of slots per task, 0 picks one from the table
+	 * size. Chunks are rounded up to a multiple of 64 slots.
+	 */
+	template <typename Table, typename Lambda>
+	void add(Table& iTable, Lambda&& iLambda, std::size_t iChunk = 0) {
+		bindings_.push_back(std::make_unique<binding<Table, Lambda>>(
+		    iTable, std::forward<Lambda>(iLambda)));
+		pending_.push_back({bindings_.back().get(),
+		                    static_cast<std::size_t>(iTable.range()), iChunk});
+	}
+
+	/**! Run everything queued with add on iExec, returns when all is done */
+	template <typename Executor> void run(Executor& iExec) {
+		std::size_t workers = std::max<std::size_t>(iExec.concurrency(), 1);
+		deques_             = std::vector<deque>(workers);
+		stats_.assign(workers, worker_stats{});
+		deal(workers);
+
+		auto start = std::chrono::steady_clock::now();
+		iExec.execute(workers, [this](std::size_t iWorker) { work(iWorker); });
+		auto wall = elapsed(start);
+		for (auto& s : stats_)
+			s.wall_ns = wall;
+
+		pending_.clear();
+		bindings_.clear();
+		deques_.clear();
+	}
+
+	/**! Run on the default thread pool */
+	void run() { run(default_thread_pool()); }
+
+	/**! Per worker counters of the last run */
+	std::span<worker_stats const> stats() const noexcept { return stats_; }
+
+private:
+	struct pending {
+		binding_base* owner;
+		std::size_t range;
+		std::size_t chunk;
+	};
+
+	static std::uint64_t
+	elapsed(std::chrono::steady_clock::time_point iStart) {
+		return static_cast<std::uint64_t>(
+		    std::chrono::duration_cast<std::chrono::nanoseconds>(
+		        std::chrono::steady_clock::now() - iStart)
+		        .count());
+	}
+
+	/**!
+	 * Consecutive chunks of a table go to the same worker so each worker
+	 * starts on a contiguous stretch, the first worker rotates per table
+	 */
+	void deal(std::size_t iWorkers) {
+		std::size_t first = 0;
+		for (auto const& p : pending_) {
+			if (!p.range)
+				continue;
+			std::size_t size = p.chunk;
+			if (!size)
+				size = p.range / (iWorkers * details::k_tasks_per_worker);
+			size = std::max<std::size_t>(size, details::k_parallel_grain);
+			size = (size + details::k_parallel_grain - 1) &
+			       ~std::size_t(details::k_parallel_grain - 1);
+
+			std::size_t count = (p.range + size - 1) / size;
+			for (std::size_t c = 0; c < count; ++c) {
+				std::size_t w = (first + c * iWorkers / count) % iWorkers;
+				deques_[w].chunks.push_back(
+				    {p.owner, c * size, std::min(p.range, (c + 1) * size)});
+			}
+			first = (first + 1) % iWorkers;
+		}
+	}
+
+	void work(std::size_t iWorker) {
+		auto& stats = stats_[iWorker];
+		chunk c;
+		for (;;) {
+			bool stolen = false;
+			if (!deques_[iWorker].pop_front(c)) {
+				stolen = steal(iWorker, c);
+				if (!stolen)
+					return;
+			}
+			auto start = std::chrono::steady_clock::now();
+			c.owner->run(c.beg, c.end);
+			stats.busy_ns += elapsed(start);
+			stats.tasks++;
+			stats.steals += stolen ? 1 : 0;
+			stats.slots += c.end - c.beg;
+		}
+	}
+
+	/**!
+	 * No chunk is queued once run starts, so a worker that finds every
+	 * deque empty is done
+	 */
+	bool steal(std::size_t iWorker, chunk& oChunk) {
+		std::size_t n = deques_.size();
+		for (std::size_t i = 1; i < n; ++i) {
+			if (deques_[(iWorker + i) % n].pop_back(oChunk))
+				return true;
+		}
+		return false;
+	}
+
+	std::vector<std::unique_ptr<binding_base>> bindings_;
+	std::vector<pending> pending_;
+	std::vector<deque> deques_;
+	std::vector<worker_stats> stats_;
+};
+
+} // namespace cpptables
@@ -1,11 +1,15 @@
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <catch2/catch.hpp>
 #include <cpptables.hpp>
 #include <iomanip>
 #include <iostream>
+#include <random>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
 
 struct SObject {
@@ -204,6 +208,10 @@ TEST_CASE("Validate tbl_sparse_sfree", "[tbl_sparse_sfree]") {
 TEST_CASE("Validate tbl_sparse_vmap", "[tbl_sparse_vmap]") {
 	validate<cpptables::tbl_sparse_vmap<CObject>>();
 }
+TEST_CASE("Validate tbl_sparse_vmap_sum", "[tbl_sparse_vmap_sum]") {
+	validate<cpptables::tbl_sparse_vmap_sum<CObject>>();
+	validate<cpptables::tbl_sparse_vmap_sum_br<CObject, &CObject::index>>();
+}
 TEST_CASE("Validate tbl_sparse_no_iter", "[tbl_sparse_no_iter]") {
 	validate<cpptables::tbl_sparse_no_iter<SObject>>();
 }
@@ -216,3 +224,1564 @@ TEST_CASE("Validate tbl_sparse_ptr", "[tbl_sparse_ptr]") {
 TEST_CASE("Validate tbl_sparse_ptr_br", "[tbl_sparse_ptr_br]") {
 	validate<cpptables::tbl_sparse_ptr_br<CObject, &CObject::index>>();
 }
+
+template <typename Cont> void validate_iteration() {
+	Cont cont;
+	std::vector<typename Cont::link> links;
+	for (std::uint32_t i = 0; i < 1000; ++i) {
+		CObject obj;
+		obj.index = i;
+		links.push_back(cont.insert(obj));
+	}
+	// leave whole words free, partial words and a free tail
+	std::vector<std::uint32_t> expected;
+	for (std::uint32_t i = 0; i < 1000; ++i) {
+		bool keep = (i >= 64 && i < 70) || (i >= 200 && i < 500 && i % 3 == 0) ||
+		            i == 640 || i == 703 || i == 960;
+		if (keep)
+			expected.push_back(i);
+		else
+			cont.erase(links[i]);
+	}
+	REQUIRE(cont.size() == expected.size());
+
+	std::vector<std::uint32_t> seen;
+	cont.for_each([&seen](CObject const& item) { seen.push_back(item.index); });
+	REQUIRE(seen == expected);
+
+	seen.clear();
+	for (auto it = cont.begin(); it != cont.end(); ++it)
+		seen.push_back((*it).index);
+	REQUIRE(seen == expected);
+
+	seen.clear();
+	for (auto it = cont.rbegin(); it != cont.rend(); ++it)
+		seen.push_back((*it).index);
+	REQUIRE(std::equal(seen.begin(), seen.end(), expected.rbegin(),
+	                   expected.rend()));
+
+	for (std::uint32_t beg : {0u, 63u, 64u, 65u, 199u, 300u}) {
+		for (std::uint32_t end : {300u, 640u, 641u, 704u, 1000u}) {
+			seen.clear();
+			cont.for_each(beg, end,
+			              [&seen](CObject const& item) { seen.push_back(item.index); });
+			std::vector<std::uint32_t> ranged;
+			for (auto i : expected)
+				if (i >= beg && i < end)
+					ranged.push_back(i);
+			REQUIRE(seen == ranged);
+		}
+	}
+}
+
+TEST_CASE("Validate tbl_sparse_vmap iteration", "[tbl_sparse_vmap]") {
+	validate_iteration<cpptables::tbl_sparse_vmap<CObject>>();
+	validate_iteration<cpptables::tbl_sparse_vmap_sum<CObject>>();
+}
+
+TEST_CASE("Validate tbl_sparse_sfree iteration", "[tbl_sparse_sfree]") {
+	validate_iteration<cpptables::tbl_sparse_sfree<CObject>>();
+}
+
+template <typename Cont> void validate_sorted_free() {
+	Cont cont;
+	std::vector<typename Cont::link> links;
+	for (std::uint32_t i = 0; i < 5000; ++i)
+		links.push_back(cont.insert(CObject()));
+	std::vector<std::uint32_t> freed;
+	for (std::uint32_t i = 0; i < 5000; ++i) {
+		if (range_rand<std::uint32_t>(0, 100) > 30 || (i >= 1000 && i < 1200)) {
+			cont.erase(links[i]);
+			freed.push_back(i);
+		}
+	}
+	REQUIRE(cont.size() == 5000 - freed.size());
+	std::uint32_t visited = 0;
+	cont.for_each([&visited](CObject const&) { visited++; });
+	REQUIRE(visited == cont.size());
+	// reinserts always take the lowest free slot
+	for (auto slot : freed) {
+		REQUIRE(cont.get_first_free_slot() == slot);
+		auto l = cont.insert(CObject());
+		REQUIRE(cpptables::details::index_t<std::uint32_t>(l.value()).index() ==
+		        slot);
+	}
+	REQUIRE(cont.get_first_free_slot() ==
+	        cpptables::details::constants<std::uint32_t>::k_null);
+	REQUIRE(cont.size() == 5000);
+}
+
+TEST_CASE("Validate tbl_sparse_sfree free order", "[tbl_sparse_sfree]") {
+	validate_sorted_free<cpptables::tbl_sparse_sfree<CObject>>();
+	validate_sorted_free<cpptables::tbl_sparse_sfree_br<CObject, &CObject::index>>();
+}
+
+template <typename Cont> void validate_runs() {
+	Cont cont;
+	std::vector<typename Cont::link> links;
+	for (std::uint32_t i = 0; i < 1000; ++i) {
+		CObject obj;
+		obj.index = i;
+		links.push_back(cont.insert(obj));
+	}
+	for (std::uint32_t i = 0; i < 1000; ++i) {
+		if ((i >= 10 && i < 200) || i % 7 == 0 || i > 900)
+			cont.erase(links[i]);
+	}
+	std::vector<CObject const*> expected;
+	cont.for_each([&expected](CObject const& item) { expected.push_back(&item); });
+
+	std::vector<CObject const*> seen;
+	CObject const* last_end = nullptr;
+	bool maximal            = true;
+	cont.for_each_run([&](std::span<CObject> run) {
+		REQUIRE(!run.empty());
+		maximal  = maximal && run.data() != last_end;
+		last_end = run.data() + run.size();
+		for (auto& item : run)
+			seen.push_back(&item);
+	});
+	REQUIRE(seen == expected);
+	REQUIRE(maximal);
+
+	seen.clear();
+	cont.for_each_run(150, 500, [&](std::span<CObject> run) {
+		for (auto& item : run)
+			seen.push_back(&item);
+	});
+	std::vector<CObject const*> ranged;
+	cont.for_each(150, 500,
+	              [&ranged](CObject const& item) { ranged.push_back(&item); });
+	REQUIRE(seen == ranged);
+}
+
+TEST_CASE("Validate for_each_run", "[for_each_run]") {
+	validate_runs<cpptables::tbl_packed<CObject>>();
+	validate_runs<cpptables::tbl_packed_br<CObject, &CObject::index>>();
+	validate_runs<cpptables::tbl_sparse_br<CObject, &CObject::index>>();
+	validate_runs<cpptables::tbl_sparse_sfree<CObject>>();
+	validate_runs<cpptables::tbl_sparse_vmap<CObject>>();
+	validate_runs<cpptables::tbl_sparse_vmap_sum<CObject>>();
+}
+
+struct sequential_executor {
+	std::size_t concurrency() const { return 4; }
+	template <typename Fn> void execute(std::size_t iCount, Fn&& iFn) {
+		for (std::size_t i = 0; i < iCount; ++i)
+			iFn(i);
+	}
+};
+
+template <typename Cont> void validate_parallel() {
+	Cont cont;
+	std::vector<typename Cont::link> links;
+	for (std::uint32_t i = 0; i < 5000; ++i) {
+		CObject obj;
+		obj.index = i;
+		links.push_back(cont.insert(obj));
+	}
+	for (std::uint32_t i = 0; i < 5000; ++i) {
+		if ((i >= 100 && i < 2000) || i % 3 == 0)
+			cont.erase(links[i]);
+	}
+	std::unordered_map<CObject const*, std::size_t> slots;
+	cont.for_each([&slots](CObject const& item) {
+		slots.emplace(&item, slots.size());
+	});
+
+	auto check = [&](auto& iExec) {
+		// catch2 assertions are not thread safe, count on workers check after
+		std::vector<std::atomic<std::uint32_t>> visits(slots.size());
+		std::atomic<std::uint32_t> strays{0};
+		cont.parallel_for_each(iExec, [&](CObject const& item) {
+			auto it = slots.find(&item);
+			if (it == slots.end())
+				strays.fetch_add(1, std::memory_order_relaxed);
+			else
+				visits[it->second].fetch_add(1, std::memory_order_relaxed);
+		});
+		REQUIRE(strays.load() == 0);
+		for (auto& v : visits)
+			REQUIRE(v.load() == 1);
+	};
+	cpptables::thread_pool pool(3);
+	check(pool);
+	sequential_executor seq;
+	check(seq);
+
+	Cont empty;
+	std::atomic<std::uint32_t> calls{0};
+	empty.parallel_for_each(pool, [&calls](CObject const&) { calls++; });
+	REQUIRE(calls.load() == 0);
+}
+
+TEST_CASE("Validate parallel_for_each", "[parallel_for_each]") {
+	validate_parallel<cpptables::tbl_packed<CObject>>();
+	validate_parallel<cpptables::tbl_packed_br<CObject, &CObject::index>>();
+	validate_parallel<cpptables::tbl_sparse_br<CObject, &CObject::index>>();
+	validate_parallel<cpptables::tbl_sparse_sfree<CObject>>();
+	validate_parallel<cpptables::tbl_sparse_vmap<CObject>>();
+	validate_parallel<cpptables::tbl_sparse_vmap_sum<CObject>>();
+}
+
+TEST_CASE("Validate work_stealing_scheduler", "[work_stealing]") {
+	cpptables::tbl_sparse_vmap<CObject> vmap;
+	cpptables::tbl_sparse_br<CObject, &CObject::index> br;
+	cpptables::tbl_packed<CObject> packed;
+	cpptables::tbl_sparse_sfree<CObject> sfree;
+
+	auto fill = [](auto& cont, std::uint32_t count) {
+		std::vector<typename std::decay_t<decltype(cont)>::link> links;
+		for (std::uint32_t i = 0; i < count; ++i)
+			links.push_back(cont.insert(CObject("obj")));
+		for (std::uint32_t i = 0; i < count; i += 3)
+			cont.erase(links[i]);
+	};
+	fill(vmap, 20000);
+	fill(br, 3000);
+	fill(packed, 100);
+	fill(sfree, 7);
+
+	std::unordered_map<CObject const*, std::size_t> slots;
+	auto record = [&slots](CObject const& item) {
+		slots.emplace(&item, slots.size());
+	};
+	vmap.for_each(record);
+	br.for_each(record);
+	packed.for_each(record);
+	sfree.for_each(record);
+
+	std::vector<std::atomic<std::uint32_t>> visits(slots.size());
+	std::atomic<std::uint32_t> strays{0};
+	auto visit = [&](CObject const& item) {
+		auto it = slots.find(&item);
+		if (it == slots.end())
+			strays.fetch_add(1, std::memory_order_relaxed);
+		else
+			visits[it->second].fetch_add(1, std::memory_order_relaxed);
+	};
+
+	cpptables::thread_pool pool(3);
+	cpptables::work_stealing_scheduler sched;
+	sched.add(vmap, visit);
+	sched.add(br, visit, 256);
+	sched.add(packed, visit);
+	sched.add(std::as_const(sfree), visit);
+	sched.run(pool);
+
+	REQUIRE(strays.load() == 0);
+	for (auto& v : visits)
+		REQUIRE(v.load() == 1);
+
+	auto stats = sched.stats();
+	REQUIRE(stats.size() == pool.concurrency());
+	std::uint64_t slots_run = 0;
+	std::uint64_t tasks     = 0;
+	for (auto const& s : stats) {
+		slots_run += s.slots;
+		tasks += s.tasks;
+		REQUIRE(s.utilization() <= 1.0);
+	}
+	REQUIRE(slots_run ==
+	        vmap.range() + br.range() + packed.range() + sfree.range());
+	REQUIRE(tasks >= 4);
+
+	// nothing queued after a run
+	sched.run(pool);
+	for (auto const& s : sched.stats())
+		REQUIRE(s.tasks == 0);
+}
+
+TEST_CASE("Validate paged tables", "[paged]") {
+	validate<cpptables::tbl_sparse_vmap_pg<CObject>>();
+	validate<cpptables::tbl_sparse_vmap_pg_br<CObject, &CObject::index>>();
+	validate<cpptables::tbl_sparse_sfree_pg<CObject>>();
+	validate<cpptables::tbl_sparse_sfree_pg_br<CObject, &CObject::index>>();
+	validate<cpptables::tbl_sparse_no_iter_pg<SObject>>();
+	validate<cpptables::tbl_sparse_no_iter_pg_br<SObject, &SObject::index>>();
+	validate_iteration<cpptables::tbl_sparse_vmap_pg<CObject>>();
+	validate_iteration<cpptables::tbl_sparse_sfree_pg<CObject>>();
+	validate_parallel<cpptables::tbl_sparse_vmap_pg<CObject>>();
+}
+
+template <typename Cont> void validate_paged() {
+	Cont cont;
+	std::vector<typename Cont::link> links;
+	std::vector<CObject const*> addresses;
+	for (std::uint32_t i = 0; i < 5000; ++i) {
+		links.push_back(cont.insert(CObject(std::to_string(i))));
+		addresses.push_back(&cont.at(links.back()));
+	}
+	// growth never moves objects
+	for (std::uint32_t i = 0; i < 5000; ++i) {
+		REQUIRE(&cont.at(links[i]) == addresses[i]);
+		REQUIRE(cont.at(links[i]).name == std::to_string(i));
+	}
+	for (std::uint32_t i = 0; i < 5000; i += 5)
+		cont.erase(links[i]);
+
+	// runs split at page ends stay contiguous in memory
+	std::vector<CObject const*> expected;
+	cont.for_each([&expected](CObject const& item) { expected.push_back(&item); });
+	std::vector<CObject const*> seen;
+	cont.for_each_run([&](std::span<CObject> run) {
+		REQUIRE(!run.empty());
+		for (auto& item : run)
+			seen.push_back(&item);
+		for (std::size_t i = 1; i < run.size(); ++i)
+			REQUIRE(&run[i] == &run[i - 1] + 1);
+	});
+	REQUIRE(seen == expected);
+}
+
+TEST_CASE("Validate paged address stability", "[paged]") {
+	validate_paged<cpptables::tbl_sparse_vmap_pg<CObject>>();
+	validate_paged<cpptables::tbl_sparse_sfree_pg<CObject>>();
+	using small_pages =
+	    cpptables::details::sparse_table_with_validmap<CObject, std::uint32_t,
+	                                                   std::allocator<CObject>,
+	                                                   cpptables::no_backref,
+	                                                   cpptables::paged<6>>;
+	validate_paged<small_pages>();
+}
+
+TEST_CASE("Validate growth policies", "[growth]") {
+	using namespace cpptables;
+	REQUIRE(grow_1_5x::grow<std::uint32_t>(0, 1, 16) == 1);
+	REQUIRE(grow_1_5x::grow<std::uint32_t>(100, 101, 16) == 150);
+	REQUIRE(grow_2x::grow<std::uint32_t>(100, 101, 16) == 200);
+	REQUIRE(grow_2x::grow<std::uint32_t>(100, 300, 16) == 300);
+	REQUIRE(grow_fixed<64>::grow<std::uint32_t>(100, 101, 16) == 164);
+	REQUIRE(grow_fixed<64>::grow<std::uint32_t>(100, 200, 16) == 228);
+	// 150 * 24 bytes rounds up to one 4KB page
+	REQUIRE(grow_page_rounded<4096>::grow<std::uint32_t>(100, 101, 24) == 170);
+	// 150 * 16 bytes = 2400, size class spacing between 2048 and 4096 is 512
+	REQUIRE(grow_size_class<>::grow<std::uint32_t>(100, 101, 16) == 160);
+	REQUIRE(grow_2x::grow<std::uint16_t>(60000, 60001, 4) == 65535);
+
+	podvector<std::uint32_t, std::allocator<std::uint32_t>, std::uint32_t,
+	          grow_fixed<10>>
+	    vec;
+	for (std::uint32_t i = 0; i < 25; ++i)
+		vec.push_back(i);
+	REQUIRE(vec.capacity() == 30);
+	for (std::uint32_t i = 0; i < 25; ++i)
+		REQUIRE(vec[i] == i);
+
+	details::sparse_table_with_validmap<CObject, std::uint32_t,
+	                                    std::allocator<CObject>, no_backref,
+	                                    std::false_type, std::false_type,
+	                                    grow_2x>
+	    vmap;
+	for (std::uint32_t i = 0; i < 9; ++i)
+		vmap.insert(CObject(std::to_string(i)));
+	REQUIRE(vmap.capacity() == 16);
+	details::sparse_table_with_sortedfree<CObject, std::uint32_t,
+	                                      std::allocator<CObject>, no_backref,
+	                                      std::false_type,
+	                                      grow_page_rounded<4096>>
+	    sfree;
+	sfree.insert(CObject("a"));
+	// as many slots as fit the page
+	REQUIRE(sfree.capacity() * sizeof(CObject) <= 4096);
+	REQUIRE((sfree.capacity() + 1) * sizeof(CObject) > 4096);
+}
+
+template <typename Cont, bool Backref = false>
+void validate_compact(std::uint32_t iBudget) {
+	Cont cont;
+	std::vector<typename Cont::link> links;
+	std::vector<std::uint32_t> ids;
+	for (std::uint32_t i = 0; i < 3000; ++i) {
+		links.push_back(cont.insert(CObject(std::to_string(i))));
+		ids.push_back(i);
+	}
+	std::uint32_t kept = 0;
+	for (std::uint32_t i = 0; i < 3000; ++i) {
+		if (range_rand<std::uint32_t>(0, 100) < 60)
+			cont.erase(links[i]);
+		else {
+			links[kept] = links[i];
+			ids[kept++] = i;
+		}
+	}
+	links.resize(kept);
+	ids.resize(kept);
+	REQUIRE(cont.size() == kept);
+
+	auto patch = [&](auto const& remap) {
+		for (auto& l : links)
+			remap.patch(l);
+	};
+	if (iBudget) {
+		cpptables::link_remap<typename Cont::link> remap;
+		std::uint32_t steps = 0;
+		while (!cont.compact_step(iBudget, remap)) {
+			REQUIRE(remap.size() <= iBudget);
+			patch(remap);
+			// the table stays usable between steps
+			if (++steps % 5 == 0) {
+				std::uint32_t at = range_rand<std::uint32_t>(0, kept - 1);
+				cont.erase(links[at]);
+				links[at] = cont.insert(CObject(std::to_string(3000 + steps)));
+				ids[at]   = 3000 + steps;
+			}
+			if (steps % 7 == 0) {
+				// fill the two lowest holes, then put the first one back at
+				// the head of the free list
+				auto first = cont.insert(CObject("first"));
+				auto second = cont.insert(CObject(std::to_string(6000 + steps)));
+				std::uint32_t at = range_rand<std::uint32_t>(0, kept - 1);
+				cont.erase(links[at]);
+				links[at] = second;
+				ids[at]   = 6000 + steps;
+				cont.erase(first);
+			}
+		}
+		patch(remap);
+		REQUIRE(steps > 0);
+	} else
+		patch(cont.compact());
+
+	REQUIRE(cont.size() == kept);
+	REQUIRE(cont.range() == kept);
+	for (std::uint32_t i = 0; i < kept; ++i) {
+		REQUIRE(cont.at(links[i]).name == std::to_string(ids[i]));
+		if constexpr (Backref)
+			REQUIRE(Cont::get_link(cont.at(links[i])) == links[i]);
+	}
+	std::uint32_t count = 0;
+	cont.for_each([&count](CObject const&) { count++; });
+	REQUIRE(count == kept);
+
+	// the compacted table keeps working
+	auto extra = cont.insert(CObject("extra"));
+	REQUIRE(cont.range() == kept + 1);
+	cont.erase(links[0]);
+	auto again = cont.insert(CObject("again"));
+	REQUIRE(cont.at(extra).name == "extra");
+	REQUIRE(cont.at(again).name == "again");
+	REQUIRE(cont.size() == kept + 1);
+	REQUIRE(cont.compact().empty());
+}
+
+TEST_CASE("Validate compact", "[compact]") {
+	for (std::uint32_t budget : {0u, 1u, 37u}) {
+		validate_compact<cpptables::tbl_sparse_br<CObject, &CObject::index>,
+		                 true>(budget);
+		validate_compact<cpptables::tbl_sparse_vmap<CObject>>(budget);
+		validate_compact<cpptables::tbl_sparse_vmap_sum<CObject>>(budget);
+		validate_compact<cpptables::tbl_sparse_vmap_pg<CObject>>(budget);
+		validate_compact<cpptables::tbl_sparse_sfree<CObject>>(budget);
+		validate_compact<cpptables::tbl_sparse_sfree_pg<CObject>>(budget);
+	}
+}
+
+/**!
+ * Four rounds of iInserts inserts then iErases erases at random, every link
+ * left is checked after each round. iInsert(id) inserts an object made from
+ * id and returns its link, iCheck(link, id) checks the object of a link.
+ */
+template <typename Cont, typename Link, typename Insert, typename Erase,
+          typename Check>
+void validate_churn(Cont& ioCont, std::vector<Link>& oLinks,
+                    std::vector<std::uint32_t>& oIds, std::uint32_t iInserts,
+                    std::uint32_t iErases, Insert&& iInsert, Erase&& iErase,
+                    Check&& iCheck) {
+	for (std::uint32_t round = 0; round < 4; ++round) {
+		for (std::uint32_t i = 0; i < iInserts; ++i) {
+			std::uint32_t id = round * 1000 + i;
+			oLinks.push_back(iInsert(id));
+			oIds.push_back(id);
+		}
+		for (std::uint32_t i = 0; i < iErases; ++i) {
+			std::uint32_t at = range_rand<std::uint32_t>(0, oLinks.size() - 1);
+			iErase(oLinks[at]);
+			oLinks.erase(oLinks.begin() + at);
+			oIds.erase(oIds.begin() + at);
+		}
+		REQUIRE(ioCont.size() == oLinks.size());
+		for (std::size_t i = 0; i < oLinks.size(); ++i)
+			iCheck(oLinks[i], oIds[i]);
+	}
+}
+
+template <typename Cont> void validate_packed_erase() {
+	using link = typename Cont::link;
+	Cont cont;
+	std::vector<link> links;
+	std::vector<std::uint32_t> ids;
+	validate_churn(
+	    cont, links, ids, 500, 300,
+	    [&](std::uint32_t iId) {
+		    return cont.insert(CObject(std::to_string(iId)));
+	    },
+	    [&](link iLink) { cont.erase(iLink); },
+	    [&](link iLink, std::uint32_t iId) {
+		    REQUIRE(cont.at(iLink).name == std::to_string(iId));
+	    });
+}
+
+TEST_CASE("Validate packed erase without backref", "[tbl_packed]") {
+	validate_packed_erase<cpptables::tbl_packed<CObject>>();
+	validate_packed_erase<cpptables::details::packed_table_with_indirection<
+	    CObject, std::uint32_t, std::allocator<CObject>, cpptables::no_backref,
+	    std::false_type>>();
+}
+
+struct particle {
+	float x    = 0;
+	float y    = 0;
+	double mass = 0;
+	std::string name;
+};
+
+TEST_CASE("Validate tbl_soa", "[tbl_soa]") {
+	cpptables::tbl_soa<float, double, std::string> cont;
+	using link = decltype(cont)::link;
+	std::vector<link> links;
+	std::vector<std::uint32_t> ids;
+	validate_churn(
+	    cont, links, ids, 400, 250,
+	    [&](std::uint32_t iId) {
+		    return cont.insert(float(iId), double(iId) * 2, std::to_string(iId));
+	    },
+	    [&](link iLink) { cont.erase(iLink); },
+	    [&](link iLink, std::uint32_t iId) {
+		    REQUIRE(cont.get<0>(iLink) == float(iId));
+		    REQUIRE(cont.get<1>(iLink) == double(iId) * 2);
+		    REQUIRE(std::get<2>(cont.at(iLink)) == std::to_string(iId));
+	    });
+	REQUIRE(reinterpret_cast<std::uintptr_t>(cont.column<0>().data()) % 64 ==
+	        0);
+	REQUIRE(reinterpret_cast<std::uintptr_t>(cont.column<1>().data()) % 64 ==
+	        0);
+
+	std::uint32_t count = 0;
+	double sum          = 0;
+	cont.for_each([&](float& x, double& y, std::string& name) {
+		REQUIRE(name == std::to_string(std::uint32_t(x)));
+		sum += y;
+		count++;
+	});
+	REQUIRE(count == links.size());
+	REQUIRE(cont.live_count(0, cont.range()) == links.size());
+
+	double run_sum     = 0;
+	std::uint32_t runs = 0;
+	cont.for_each_run([&](std::uint32_t iFirst, std::span<float> iX,
+	                      std::span<double> iY, std::span<std::string>) {
+		REQUIRE(iX.data() == cont.column<0>().data() + iFirst);
+		REQUIRE(iX.size() == iY.size());
+		for (std::uint32_t i = 0; i < iX.size(); ++i) {
+			REQUIRE(cont.is_valid(iFirst + i));
+			run_sum += iY[i];
+		}
+		runs++;
+	});
+	REQUIRE(run_sum == sum);
+	REQUIRE(runs > 0);
+
+	// lowest free slot is reused first
+	cont.erase(links.back());
+	std::uint32_t lowest = 0;
+	while (cont.is_valid(lowest))
+		lowest++;
+	auto reused = cont.insert(1.0f, 2.0, "reused");
+	REQUIRE(cont.get<2>(reused) == "reused");
+	REQUIRE(cont.is_valid(lowest));
+	links.back() = reused;
+
+	sequential_executor exec;
+	std::atomic<std::uint32_t> visited = 0;
+	cont.parallel_for_each(exec, [&](float const&, double const&,
+	                                 std::string const&) { visited++; });
+	REQUIRE(visited == cont.size());
+
+	cont.clear();
+	REQUIRE(cont.size() == 0);
+	auto after = cont.insert(3.0f, 4.0, "after");
+	REQUIRE(cont.get<0>(after) == 3.0f);
+}
+
+TEST_CASE("Validate tbl_soa_of", "[tbl_soa]") {
+	cpptables::tbl_soa_of<particle, &particle::x, &particle::mass,
+	                      &particle::name>
+	    cont;
+	std::vector<cpptables::link<particle, std::uint32_t>> links;
+	for (std::uint32_t i = 0; i < 300; ++i) {
+		particle p;
+		p.x    = float(i);
+		p.y    = 99.0f;
+		p.mass = i * 0.5;
+		p.name = std::to_string(i);
+		links.push_back(cont.insert(p));
+	}
+	for (std::uint32_t i = 0; i < 300; i += 3)
+		cont.erase(links[i]);
+	for (std::uint32_t i = 0; i < 300; ++i) {
+		if (i % 3 == 0)
+			continue;
+		REQUIRE(cont.get_member<&particle::mass>(links[i]) == i * 0.5);
+		particle p = cont.gather(links[i]);
+		REQUIRE(p.x == float(i));
+		REQUIRE(p.y == 0.0f);
+		REQUIRE(p.name == std::to_string(i));
+	}
+	auto masses = cont.member_column<&particle::mass>();
+	REQUIRE(masses.size() == cont.range());
+	REQUIRE(masses[1] == 0.5);
+}
+
+struct hot_part {
+	float x          = 0;
+	std::uint32_t id = 0;
+};
+
+template <typename Cont> void validate_hot_cold() {
+	static_assert(Cont::k_cold);
+	using link = typename Cont::link;
+	Cont cont;
+	std::vector<link> links;
+	std::vector<std::uint32_t> ids;
+	validate_churn(
+	    cont, links, ids, 500, 300,
+	    [&](std::uint32_t iId) {
+		    return cont.insert(hot_part{float(iId), iId},
+		                       CObject(std::to_string(iId)));
+	    },
+	    [&](link iLink) { cont.erase(iLink); },
+	    [&](link iLink, std::uint32_t iId) {
+		    REQUIRE(cont.at(iLink).id == iId);
+		    REQUIRE(cont.cold(iLink).name == std::to_string(iId));
+	    });
+	std::uint32_t count = 0;
+	cont.for_each_hot([&count](hot_part const&) { count++; });
+	REQUIRE(count == links.size());
+	count = 0;
+	cont.for_each_hot_cold([&count](hot_part& iHot, CObject& iCold) {
+		REQUIRE(iCold.name == std::to_string(iHot.id));
+		count++;
+	});
+	REQUIRE(count == links.size());
+
+	auto plain = cont.insert(hot_part{1.0f, 7});
+	REQUIRE(cont.cold(plain).name == "default");
+	cont.erase(plain);
+}
+
+TEST_CASE("Validate hot/cold split", "[hot_cold]") {
+	validate_hot_cold<cpptables::tbl_packed_hc<hot_part, CObject>>();
+	validate_hot_cold<cpptables::tbl_sparse_vmap_hc<hot_part, CObject>>();
+	validate_hot_cold<cpptables::tbl_sparse_vmap_pg_hc<hot_part, CObject>>();
+
+	// compaction moves both parts
+	cpptables::tbl_sparse_vmap_hc<hot_part, CObject> cont;
+	std::vector<cpptables::link<hot_part, std::uint32_t>> links;
+	for (std::uint32_t i = 0; i < 200; ++i)
+		links.push_back(
+		    cont.insert(hot_part{float(i), i}, CObject(std::to_string(i))));
+	for (std::uint32_t i = 0; i < 200; i += 2)
+		cont.erase(links[i]);
+	auto remap = cont.compact();
+	REQUIRE(cont.range() == 100);
+	for (std::uint32_t i = 1; i < 200; i += 2) {
+		auto l = links[i];
+		remap.patch(l);
+		REQUIRE(cont.at(l).id == i);
+		REQUIRE(cont.cold(l).name == std::to_string(i));
+	}
+}
+
+struct small_object {
+	small_object() = default;
+	small_object(std::uint32_t iId) {
+		std::snprintf(name, sizeof(name), "%u", static_cast<unsigned>(iId));
+	}
+	char name[14]       = {};
+	std::uint16_t index = 0;
+};
+
+template <typename Cont> void validate_small() {
+	using link = typename Cont::link;
+	static_assert(sizeof(link) == sizeof(std::uint16_t));
+	constexpr bool is_p = std::is_pointer_v<typename Cont::value_type>;
+	Cont cont;
+	std::vector<std::unique_ptr<small_object>> owned;
+	std::vector<link> links;
+	std::vector<std::uint32_t> ids;
+	auto user = [](link iLink) {
+		if constexpr (is_p)
+			return typename Cont::ulink(iLink.value());
+		else
+			return iLink;
+	};
+	auto name_of = [&](link iLink) {
+		return std::string(cont.at(user(iLink)).name);
+	};
+	validate_churn(
+	    cont, links, ids, 900, 400,
+	    [&](std::uint32_t iId) {
+		    if constexpr (is_p) {
+			    owned.push_back(std::make_unique<small_object>(iId));
+			    return cont.insert(owned.back().get());
+		    } else {
+			    return cont.insert(small_object(iId));
+		    }
+	    },
+	    [&](link iLink) { cont.erase(user(iLink)); },
+	    [&](link iLink, std::uint32_t iId) {
+		    REQUIRE(name_of(iLink) == std::to_string(iId));
+	    });
+	if constexpr ((static_cast<unsigned>(Cont::tags) &
+	               cpptables::tags::no_iter::value) == 0) {
+		std::uint32_t count = 0;
+		cont.for_each([&count](auto const&) { count++; });
+		REQUIRE(count == links.size());
+	}
+}
+
+template <auto Tags>
+using small_tbl = cpptables::table<Tags, small_object, 0, std::uint16_t,
+                                   std::allocator<small_object>>;
+template <auto Tags>
+using small_tbl_br =
+    cpptables::table<Tags, small_object, &small_object::index, std::uint16_t,
+                     std::allocator<small_object>>;
+
+TEST_CASE("Validate 16 bit tables", "[uint16]") {
+	validate_small<small_tbl<cpptables::tv_packed>>();
+	validate_small<small_tbl_br<cpptables::tv_packed_br>>();
+	validate_small<small_tbl<cpptables::tv_sparse_ptr>>();
+	validate_small<small_tbl_br<cpptables::tv_sparse_ptr_br>>();
+	validate_small<small_tbl_br<cpptables::tv_sparse_br>>();
+	validate_small<small_tbl<cpptables::tv_sparse_no_iter>>();
+	validate_small<small_tbl_br<cpptables::tv_sparse_no_iter_br>>();
+	validate_small<small_tbl<cpptables::tv_sparse_sfree>>();
+	validate_small<small_tbl_br<cpptables::tv_sparse_sfree_br>>();
+	validate_small<small_tbl<cpptables::tv_sparse_vmap>>();
+	validate_small<small_tbl_br<cpptables::tv_sparse_vmap_br>>();
+	validate_small<small_tbl<cpptables::tv_sparse_vmap_sum>>();
+	validate_small<small_tbl<cpptables::tv_sparse_vmap_pg>>();
+	validate_small<small_tbl<cpptables::tv_sparse_sfree_pg>>();
+
+	cpptables::podvector<std::uint16_t, std::allocator<std::uint16_t>,
+	                     std::uint16_t>
+	    indices;
+	for (std::uint16_t i = 0; i < 3000; ++i)
+		indices.push_back(i);
+	REQUIRE(indices.size() == 3000);
+	REQUIRE(indices[2999] == 2999);
+}
+
+template <typename Cont> void validate_generations() {
+	Cont cont;
+	using link = typename Cont::link;
+	std::vector<link> links;
+	for (std::uint32_t i = 0; i < 100; ++i)
+		links.push_back(cont.insert(CObject(std::to_string(i))));
+	// every erase and reuse of slot 5 makes the older links stale
+	link stale = links[5];
+	for (std::uint32_t round = 0; round < 3; ++round) {
+		cont.erase(links[5]);
+		REQUIRE(cont.try_at(links[5]) == nullptr);
+		links[5] = cont.insert(CObject("again"));
+		REQUIRE(links[5] != stale);
+		REQUIRE(cont.try_at(stale) == nullptr);
+		REQUIRE(cont.try_at(links[5]) != nullptr);
+		REQUIRE(cont.try_at(links[5])->name == "again");
+		REQUIRE(&cont.at(links[5]) == cont.try_at(links[5]));
+		stale = links[5];
+	}
+	for (std::uint32_t i = 0; i < 100; ++i) {
+		if (i != 5)
+			REQUIRE(cont.try_at(links[i])->name == std::to_string(i));
+	}
+	REQUIRE(cont.try_at(link(1000)) == nullptr);
+
+	// a stale link is refused, never applied to the slot's new object
+	link old = links[7];
+	REQUIRE(cont.erase(old));
+	links[7] = cont.insert(CObject("seven"));
+	REQUIRE_FALSE(cont.erase(old));
+	REQUIRE_THROWS_AS(cont.at(old), std::out_of_range);
+	REQUIRE(cont.try_at(links[7])->name == "seven");
+	REQUIRE(cont.size() == 100);
+
+	// clear keeps every old link stale
+	cont.clear();
+	auto fresh = cont.insert(CObject("fresh"));
+	for (auto l : links)
+		REQUIRE(cont.try_at(l) == nullptr);
+	REQUIRE(cont.try_at(fresh)->name == "fresh");
+}
+
+template <typename Cont> void validate_generation_limit() {
+	constexpr std::uint32_t k_limit =
+	    cpptables::details::constants<std::uint16_t>::k_index_mask;
+	Cont cont;
+	std::vector<typename Cont::link> links;
+	for (std::uint32_t i = 0; i < 5000; ++i)
+		links.push_back(cont.insert(small_object(i)));
+	REQUIRE(cont.size() == k_limit);
+	for (std::uint32_t i = 0; i < 5000; ++i) {
+		if (i < k_limit)
+			REQUIRE(std::string(cont.at(links[i]).name) == std::to_string(i));
+		else
+			REQUIRE_FALSE(links[i]);
+	}
+	// a freed slot is taken again
+	REQUIRE(cont.erase(links[0]));
+	auto again = cont.insert(small_object(9999));
+	REQUIRE(again);
+	REQUIRE(std::string(cont.at(again).name) == "9999");
+}
+
+TEST_CASE("Validate generational links", "[generational]") {
+	validate<cpptables::tbl_packed_gen<CObject>>();
+	validate<cpptables::tbl_packed_gen_br<CObject, &CObject::index>>();
+	validate<cpptables::tbl_sparse_vmap_gen<CObject>>();
+	validate<cpptables::tbl_sparse_vmap_gen_br<CObject, &CObject::index>>();
+	validate_generations<cpptables::tbl_packed_gen<CObject>>();
+	validate_generations<cpptables::tbl_packed_gen_br<CObject, &CObject::index>>();
+	validate_generations<cpptables::tbl_sparse_vmap_gen<CObject>>();
+	validate_generations<
+	    cpptables::tbl_sparse_vmap_gen_br<CObject, &CObject::index>>();
+	for (std::uint32_t budget : {0u, 7u}) {
+		validate_compact<cpptables::tbl_sparse_vmap_gen<CObject>>(budget);
+		validate_compact<
+		    cpptables::tbl_sparse_vmap_gen_br<CObject, &CObject::index>>(budget);
+	}
+	validate_small<small_tbl<cpptables::tv_packed_gen>>();
+	validate_small<small_tbl<cpptables::tv_sparse_vmap_gen>>();
+	validate_generation_limit<small_tbl<cpptables::tv_packed_gen>>();
+	validate_generation_limit<small_tbl<cpptables::tv_sparse_vmap_gen>>();
+
+	// slots dropped by compaction and clear come back with a newer
+	// generation, links from before stay stale
+	{
+		cpptables::tbl_sparse_vmap_gen<CObject> cont;
+		auto a = cont.insert(CObject("a"));
+		auto b = cont.insert(CObject("b"));
+		auto c = cont.insert(CObject("c"));
+		cont.erase(a);
+		auto remap = cont.compact();
+		REQUIRE(cont.range() == 2);
+		auto d     = cont.insert(CObject("d"));
+		auto moved = c;
+		REQUIRE(remap.patch(moved));
+		REQUIRE(cont.try_at(a) == nullptr);
+		REQUIRE(cont.try_at(c) == nullptr);
+		REQUIRE_FALSE(cont.erase(c));
+		REQUIRE(cont.try_at(moved)->name == "c");
+		REQUIRE(cont.try_at(b)->name == "b");
+		REQUIRE(cont.try_at(d)->name == "d");
+		cont.clear();
+		auto e = cont.insert(CObject("e"));
+		for (auto l : {b, moved, d})
+			REQUIRE(cont.try_at(l) == nullptr);
+		REQUIRE(cont.try_at(e)->name == "e");
+	}
+
+	// without generations try_at still rejects erased and unknown slots
+	cpptables::tbl_sparse_vmap<CObject> plain;
+	auto first  = plain.insert(CObject("first"));
+	auto second = plain.insert(CObject("second"));
+	plain.erase(first);
+	REQUIRE(plain.try_at(first) == nullptr);
+	REQUIRE(plain.try_at(second)->name == "second");
+	REQUIRE(plain.try_at(decltype(first)(1000)) == nullptr);
+}
+
+template <typename Cont, std::size_t Distance> void validate_gather() {
+	Cont cont;
+	using link = typename helper<Cont>::link;
+	typename helper<Cont>::set_t check;
+	typename helper<Cont>::cleanup_list cleaner;
+	helper<Cont>::insert(check, 0, cont, 500, cleaner);
+	for (std::uint32_t i = 0; i < 500; i += 3) {
+		auto it = check.second.find(std::to_string(i) + ".o");
+		cont.erase(it->second);
+		check.first.erase(it->second);
+		check.second.erase(it);
+	}
+	std::vector<link> links;
+	for (auto const& entry : check.first)
+		links.push_back(entry.first);
+	// repeat a few links, lookups need not be unique
+	links.push_back(links.front());
+	links.push_back(links.back());
+
+	std::vector<typename helper<Cont>::utype> out;
+	cont.template gather<Distance>(std::span<link const>(links),
+	                               std::back_inserter(out));
+	REQUIRE(out.size() == links.size());
+	for (std::size_t i = 0; i < links.size(); ++i)
+		REQUIRE(std::string_view(out[i].name) == check.first[links[i]]);
+
+	std::size_t visited = 0;
+	cont.template for_each_link<Distance>(
+	    std::span<link const>(links), [&](auto& iObject) {
+		    REQUIRE(&iObject == &cont.at(links[visited]));
+		    visited++;
+	    });
+	REQUIRE(visited == links.size());
+	Cont const& ccont = cont;
+	visited           = 0;
+	ccont.template for_each_link<Distance>(
+	    std::span<link const>(links), [&](auto const& iObject) {
+		    REQUIRE(std::string_view(iObject.name) ==
+		            check.first[links[visited++]]);
+	    });
+	REQUIRE(cont.gather(std::span<link const>(), out.begin()) == out.begin());
+}
+
+template <typename Cont> void validate_gather() {
+	validate_gather<Cont, 0>();
+	validate_gather<Cont, 1>();
+	validate_gather<Cont, cpptables::k_prefetch_distance>();
+}
+
+TEST_CASE("Validate gather", "[gather]") {
+	validate_gather<cpptables::tbl_packed<CObject>>();
+	validate_gather<cpptables::tbl_packed_br<CObject, &CObject::index>>();
+	validate_gather<cpptables::tbl_packed_gen<CObject>>();
+	validate_gather<cpptables::tbl_sparse_br<CObject, &CObject::index>>();
+	validate_gather<cpptables::tbl_sparse_sfree<CObject>>();
+	validate_gather<cpptables::tbl_sparse_vmap<CObject>>();
+	validate_gather<cpptables::tbl_sparse_vmap_gen<CObject>>();
+	validate_gather<cpptables::tbl_sparse_vmap_pg<CObject>>();
+	validate_gather<cpptables::tbl_sparse_no_iter<SObject>>();
+	validate_gather<cpptables::tbl_sparse_ptr<CObject>>();
+
+	cpptables::tbl_soa_of<particle, &particle::x, &particle::name> soa;
+	using link = decltype(soa)::link;
+	std::vector<link> links;
+	for (int i = 0; i < 100; ++i)
+		links.push_back(soa.insert(particle{float(i), 0, 0, std::to_string(i)}));
+	std::reverse(links.begin(), links.end());
+	std::vector<particle> out;
+	soa.gather(std::span<link const>(links), std::back_inserter(out));
+	REQUIRE(out.size() == 100);
+	for (int i = 0; i < 100; ++i) {
+		REQUIRE(out[i].x == float(99 - i));
+		REQUIRE(out[i].name == std::to_string(99 - i));
+	}
+	float sum = 0;
+	soa.for_each_link(std::span<link const>(links),
+	                  [&](float& iX, std::string&) { sum += iX; });
+	REQUIRE(sum == 4950.0f);
+}
+
+template <typename Cont> void validate_view_locality() {
+	Cont cont;
+	using link = typename Cont::link;
+	std::vector<link> links;
+	for (std::uint32_t i = 0; i < 1000; ++i)
+		links.push_back(cont.insert(CObject(std::to_string(i))));
+	for (std::uint32_t i = 0; i < 1000; i += 4)
+		cont.erase(links[i]);
+	std::vector<link> members;
+	for (std::uint32_t i = 0; i < 1000; ++i)
+		if (i % 4 && i % 3)
+			members.push_back(links[i]);
+	std::shuffle(members.begin(), members.end(), std::mt19937(7));
+
+	cpptables::basic_view<Cont> view(cont);
+	for (auto l : members)
+		view.insert(l);
+	REQUIRE(view.size() == members.size());
+	std::size_t visited = 0;
+	view.for_each([&](CObject& iObject) {
+		REQUIRE(&iObject == &cont.at(members[visited++]));
+	});
+	REQUIRE(visited == members.size());
+	visited = 0;
+	view.template for_each<0>(10, 20, [&](CObject& iObject) {
+		REQUIRE(&iObject == &cont.at(members[10 + visited++]));
+	});
+	REQUIRE(visited == 10);
+
+	view.sort_by_location();
+	REQUIRE(view.size() == members.size());
+	CObject const* last = nullptr;
+	std::uint32_t seen  = 0;
+	view.for_each([&](CObject& iObject) {
+		REQUIRE(std::less<CObject const*>()(last, &iObject));
+		last = &iObject;
+		seen++;
+	});
+	REQUIRE(seen == members.size());
+	for (auto l : members)
+		REQUIRE(&view.at(view.find(l)) == &cont.at(l));
+	view.erase(members.front());
+	REQUIRE(view.size() == members.size() - 1);
+	REQUIRE(view.find(members.front()) ==
+	        cpptables::details::constants<std::uint32_t>::k_null);
+
+	cpptables::sorted_view<Cont> sorted(cont);
+	for (auto l : members)
+		sorted.insert(l);
+	std::sort(members.begin(), members.end());
+	REQUIRE(sorted.size() == members.size());
+	for (std::uint32_t i = 0; i < sorted.size(); ++i)
+		REQUIRE(&sorted.at(i) == &cont.at(members[i]));
+}
+
+TEST_CASE("Validate view locality", "[view]") {
+	validate_view_locality<cpptables::tbl_sparse_vmap_br<CObject, &CObject::index>>();
+	validate_view_locality<cpptables::tbl_sparse_br<CObject, &CObject::index>>();
+	validate_view_locality<cpptables::tbl_packed_br<CObject, &CObject::index>>();
+}
+
+template <typename Cont> void validate_view_positions() {
+	Cont cont;
+	using link = typename Cont::link;
+	using view = cpptables::basic_view<Cont, cpptables::with_positions>;
+	constexpr auto k_null = cpptables::details::constants<std::uint32_t>::k_null;
+	std::vector<link> links;
+	for (std::uint32_t i = 0; i < 2000; ++i)
+		links.push_back(cont.insert(CObject(std::to_string(i))));
+	view members(cont);
+	std::vector<bool> in(links.size(), false);
+	std::mt19937 rng(11);
+	for (std::uint32_t step = 0; step < 20000; ++step) {
+		std::uint32_t i = rng() % links.size();
+		if (rng() & 1) {
+			members.insert(links[i]);
+			in[i] = true;
+		} else {
+			REQUIRE(members.erase(links[i]) == in[i]);
+			in[i] = false;
+		}
+	}
+	std::size_t count = 0;
+	for (std::uint32_t i = 0; i < links.size(); ++i) {
+		REQUIRE(members.contains(links[i]) == in[i]);
+		if (in[i]) {
+			REQUIRE(&members.at(members.find(links[i])) == &cont.at(links[i]));
+			count++;
+		} else {
+			REQUIRE(members.find(links[i]) == k_null);
+		}
+	}
+	REQUIRE(members.size() == count);
+
+	// a reused slot does not make the stale link a member
+	std::uint32_t gone = 0;
+	while (!in[gone])
+		gone++;
+	members.erase(links[gone]);
+	cont.erase(links[gone]);
+	link again = cont.insert(CObject("again"));
+	members.insert(again);
+	REQUIRE(members.contains(again));
+	if (again != links[gone])
+		REQUIRE(!members.contains(links[gone]));
+
+	members.sort_by_location();
+	view copy(members);
+	for (std::uint32_t i = 0; i < links.size(); ++i) {
+		if (in[i] && i != gone)
+			REQUIRE(&copy.at(copy.find(links[i])) == &cont.at(links[i]));
+	}
+	REQUIRE(&copy.at(copy.find(again)) == &cont.at(again));
+
+	// a link to the new object of a member's slot replaces the stale member
+	auto position = members.find(again);
+	cont.erase(again);
+	link renewed = cont.insert(CObject("renewed"));
+	members.insert(renewed);
+	REQUIRE(members.size() == count);
+	REQUIRE(members.find(renewed) == position);
+	REQUIRE(&members.at(position) == &cont.at(renewed));
+	if (renewed != again)
+		REQUIRE_FALSE(members.erase(again));
+	REQUIRE(members.erase(renewed));
+	REQUIRE(members.size() == count - 1);
+	REQUIRE_FALSE(members.contains(renewed));
+}
+
+TEST_CASE("Validate view positions", "[view]") {
+	validate_view_positions<cpptables::tbl_sparse_vmap<CObject>>();
+	validate_view_positions<cpptables::tbl_sparse_vmap_gen<CObject>>();
+	validate_view_positions<cpptables::tbl_packed<CObject>>();
+	validate_view_positions<cpptables::tbl_packed_gen<CObject>>();
+	validate_view_positions<cpptables::tbl_sparse_sfree<CObject>>();
+}
+
+TEST_CASE("Validate sorted_view bulk and set operations", "[view]") {
+	using table = cpptables::tbl_sparse_vmap<CObject>;
+	using link  = table::link;
+	using view  = cpptables::sorted_view<table>;
+	table cont;
+	std::vector<link> links;
+	for (std::uint32_t i = 0; i < 3000; ++i)
+		links.push_back(cont.insert(CObject(std::to_string(i))));
+	auto pick = [&](std::uint32_t iMod) {
+		std::vector<link> result;
+		for (std::uint32_t i = 0; i < links.size(); ++i)
+			if (i % iMod == 0)
+				result.push_back(links[i]);
+		std::shuffle(result.begin(), result.end(), std::mt19937(iMod));
+		return result;
+	};
+
+	view twos(cont), threes(cont);
+	auto by_two = pick(2);
+	twos.insert(links[4]);
+	twos.insert_bulk(by_two);
+	twos.insert_bulk(std::span<link const>(by_two).first(100));
+	REQUIRE(twos.size() == 1500);
+	threes.insert_bulk(pick(3));
+	REQUIRE(threes.size() == 1000);
+	for (std::uint32_t i = 0; i < links.size(); ++i) {
+		REQUIRE(twos.contains(links[i]) == (i % 2 == 0));
+		REQUIRE(threes.contains(links[i]) == (i % 3 == 0));
+	}
+
+	auto both   = twos.set_intersection(threes);
+	auto either = twos.set_union(threes);
+	auto only   = twos.set_difference(threes);
+	REQUIRE(both.size() == 500);
+	REQUIRE(either.size() == 2000);
+	REQUIRE(only.size() == 1000);
+	for (std::uint32_t i = 0; i < links.size(); ++i) {
+		REQUIRE(both.contains(links[i]) == (i % 6 == 0));
+		REQUIRE(either.contains(links[i]) == (i % 2 == 0 || i % 3 == 0));
+		REQUIRE(only.contains(links[i]) == (i % 2 == 0 && i % 3 != 0));
+	}
+	// nothing was erased from the table, link order is address order
+	for (std::uint32_t i = 1; i < either.size(); ++i)
+		REQUIRE(&either.at(i - 1) < &either.at(i));
+
+	REQUIRE(either.erase_bulk(pick(6)) == 500);
+	REQUIRE(either.erase_bulk(pick(6)) == 0);
+	REQUIRE(either.size() == 1500);
+	REQUIRE(!either.erase(links[0]));
+	REQUIRE(either.find(links[0]) ==
+	        cpptables::details::constants<std::uint32_t>::k_null);
+	for (std::uint32_t i = 0; i < links.size(); ++i)
+		REQUIRE(either.contains(links[i]) ==
+		        ((i % 2 == 0 || i % 3 == 0) && i % 6 != 0));
+}
+
+template <typename Cont> void validate_bitset_view() {
+	Cont cont;
+	using link = typename Cont::link;
+	using view = cpptables::bitset_view<Cont>;
+	std::vector<link> links;
+	for (std::uint32_t i = 0; i < 1000; ++i)
+		links.push_back(cont.insert(CObject(std::to_string(i))));
+	// free a few slots so links carry spoilers or generations
+	for (std::uint32_t i = 0; i < 1000; i += 7) {
+		cont.erase(links[i]);
+		links[i] = cont.insert(CObject(std::to_string(i)));
+	}
+	view twos(cont), threes(cont);
+	for (std::uint32_t i = 0; i < links.size(); ++i) {
+		if (i % 2 == 0)
+			REQUIRE(twos.insert(links[i]));
+		if (i % 3 == 0)
+			REQUIRE(threes.insert(links[i]));
+	}
+	REQUIRE(!twos.insert(links[0]));
+	REQUIRE(twos.size() == 500);
+	REQUIRE(threes.size() == 334);
+
+	auto both   = twos & threes;
+	auto either = twos | threes;
+	auto only   = difference(twos, threes);
+	REQUIRE(both.size() == 167);
+	REQUIRE(either.size() == 667);
+	REQUIRE(only.size() == 333);
+	for (std::uint32_t i = 0; i < links.size(); ++i) {
+		REQUIRE(twos.contains(links[i]) == (i % 2 == 0));
+		REQUIRE(both.contains(links[i]) == (i % 6 == 0));
+		REQUIRE(either.contains(links[i]) == (i % 2 == 0 || i % 3 == 0));
+		REQUIRE(only.contains(links[i]) == (i % 2 == 0 && i % 3 != 0));
+	}
+
+	std::size_t visited = 0;
+	CObject const* last = nullptr;
+	both.for_each([&](CObject& iObject) {
+		REQUIRE(std::stoi(iObject.name) % 6 == 0);
+		REQUIRE(std::less<CObject const*>()(last, &iObject));
+		last = &iObject;
+		visited++;
+	});
+	REQUIRE(visited == both.size());
+
+	REQUIRE(either.erase(links[0]));
+	REQUIRE(!either.erase(links[0]));
+	REQUIRE(!either.contains(links[0]));
+	REQUIRE(either.size() == 666);
+	either.clear();
+	REQUIRE(either.empty());
+	REQUIRE(!either.contains(links[2]));
+}
+
+TEST_CASE("Validate bitset_view", "[view]") {
+	validate_bitset_view<cpptables::tbl_sparse_vmap<CObject>>();
+	validate_bitset_view<cpptables::tbl_sparse_vmap_gen<CObject>>();
+	validate_bitset_view<cpptables::tbl_sparse_sfree<CObject>>();
+	validate_bitset_view<cpptables::tbl_sparse_br<CObject, &CObject::index>>();
+}
+
+TEST_CASE("Validate compressed_view", "[view]") {
+	using table = cpptables::tbl_sparse_vmap<std::uint32_t>;
+	using link  = table::link;
+	using view  = cpptables::compressed_view<table>;
+	constexpr auto k_null = cpptables::details::constants<std::uint32_t>::k_null;
+	table cont;
+	std::vector<link> links;
+	for (std::uint32_t i = 0; i < 300000; ++i)
+		links.push_back(cont.insert(i));
+
+	// a dense run, a bitmap sized chunk, a sparse array chunk
+	auto in_first = [](std::uint32_t i) {
+		return (i >= 1000 && i < 60000) || (i >= 70000 && i < 130000 && i % 3) ||
+		       (i >= 200000 && i % 97 == 0);
+	};
+	auto in_second = [](std::uint32_t i) { return i % 2 == 0; };
+	view first(cont), second(cont);
+	std::mt19937 rng(5);
+	std::vector<std::uint32_t> order(links.size());
+	for (std::uint32_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), rng);
+	std::size_t first_count = 0;
+	for (auto i : order) {
+		if (in_first(i)) {
+			REQUIRE(first.insert(links[i]));
+			first_count++;
+		}
+		if (in_second(i))
+			second.insert(links[i]);
+	}
+	REQUIRE(!first.insert(links[1000]));
+	REQUIRE(first.size() == first_count);
+
+	auto check = [&](view const& iView, auto&& iIn) {
+		std::uint32_t rank = 0;
+		for (std::uint32_t i = 0; i < links.size(); i += 7) {
+			REQUIRE(iView.contains(links[i]) == iIn(i));
+		}
+		std::uint32_t expected = 0;
+		iView.for_each([&](std::uint32_t& iValue) {
+			while (!iIn(expected))
+				expected++;
+			REQUIRE(iValue == expected);
+			REQUIRE(iView.find(links[iValue]) == rank++);
+			expected++;
+		});
+		REQUIRE(rank == iView.size());
+	};
+	check(first, in_first);
+	REQUIRE(first.find(links[0]) == k_null);
+
+	std::size_t before = first.bytes();
+	first.optimize();
+	REQUIRE(first.bytes() < before);
+	check(first, in_first);
+
+	auto both = first & second;
+	check(both, [&](std::uint32_t i) { return in_first(i) && in_second(i); });
+
+	cpptables::sorted_view<table> sorted(cont);
+	std::vector<link> odd;
+	for (std::uint32_t i = 1; i < links.size(); i += 2)
+		odd.push_back(links[i]);
+	sorted.insert_bulk(odd);
+	auto filtered = first.intersect(sorted);
+	std::uint32_t next = 0;
+	for (std::uint32_t i = 0; i < filtered.size(); ++i) {
+		while (!(in_first(next) && next % 2))
+			next++;
+		REQUIRE(filtered.at(i) == next++);
+	}
+
+	// erase through run, bitmap and array chunks
+	for (std::uint32_t i = 0; i < links.size(); ++i) {
+		if (in_first(i) && i % 5 == 0)
+			REQUIRE(first.erase(links[i]));
+	}
+	REQUIRE(!first.erase(links[0]));
+	check(first, [&](std::uint32_t i) { return in_first(i) && i % 5; });
+	for (std::uint32_t i = 0; i < links.size(); ++i)
+		first.erase(links[i]);
+	REQUIRE(first.empty());
+	first.optimize();
+	REQUIRE(first.bytes() == 0);
+}
+
+template <typename Cont> void validate_concurrent() {
+	constexpr std::uint32_t k_threads = 4, k_count = 20000;
+	Cont cont(k_threads * k_count);
+	std::vector<std::vector<typename Cont::link>> links(k_threads);
+	std::vector<std::thread> workers;
+	// catch2 assertions are not thread safe, workers record links only
+	for (std::uint32_t t = 0; t < k_threads; ++t) {
+		workers.emplace_back([&cont, &links, t] {
+			auto& own = links[t];
+			for (std::uint32_t i = 0; i < k_count; ++i) {
+				CObject obj(std::to_string(t));
+				obj.index = t * k_count + i;
+				own.push_back(cont.insert(obj));
+				// recycle slots while other threads pop and push the free list
+				if (i % 4 == 3) {
+					cont.erase(own[own.size() - 2]);
+					own.erase(own.end() - 2);
+				}
+			}
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+	workers.clear();
+
+	std::uint32_t expected = k_threads * (k_count - k_count / 4);
+	REQUIRE(cont.size() == expected);
+	REQUIRE(cont.range() <= k_threads * k_count);
+	std::vector<std::uint32_t> seen;
+	cont.for_each([&seen](CObject const& iObj) { seen.push_back(iObj.index); });
+	REQUIRE(seen.size() == expected);
+	std::sort(seen.begin(), seen.end());
+	REQUIRE(std::adjacent_find(seen.begin(), seen.end()) == seen.end());
+	for (std::uint32_t t = 0; t < k_threads; ++t) {
+		for (auto l : links[t]) {
+			CObject* obj = cont.try_at(l);
+			REQUIRE(obj);
+			REQUIRE(obj->name == std::to_string(t));
+		}
+	}
+
+	// every thread erases every link of thread 0, each link goes only once
+	std::atomic<std::uint32_t> erased{0};
+	for (std::uint32_t t = 0; t < k_threads; ++t) {
+		workers.emplace_back([&cont, &links, &erased] {
+			for (auto l : links[0]) {
+				if (cont.erase(l))
+					erased.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+	REQUIRE(erased.load() == links[0].size());
+	REQUIRE(cont.size() == expected - links[0].size());
+	for (auto l : links[0])
+		REQUIRE(!cont.try_at(l));
+	REQUIRE(!cont.erase(links[0][0]));
+
+	// erased slots are reused before range grows
+	auto range = cont.range();
+	CObject obj;
+	for (std::size_t i = 0; i < links[0].size(); ++i)
+		cont.insert(obj);
+	REQUIRE(cont.range() == range);
+	cont.clear();
+	REQUIRE(cont.size() == 0);
+	REQUIRE(!cont.try_at(links[1][0]));
+}
+
+TEST_CASE("Validate concurrent table", "[concurrent]") {
+	validate_concurrent<cpptables::tbl_sparse_conc<CObject>>();
+	validate_concurrent<cpptables::tbl_sparse_conc_br<CObject, &CObject::index>>();
+
+	cpptables::tbl_sparse_conc_br<CObject, &CObject::index> cont(16);
+	auto l = cont.emplace("first");
+	REQUIRE(cont.at(l).index == l.value());
+	REQUIRE(cont.erase(cont.at(l)));
+	REQUIRE(cont.size() == 0);
+	REQUIRE(cont.max_size() == 16);
+}
+
+struct NObject {
+	using link          = cpptables::link<NObject, std::uint32_t>;
+	std::uint32_t index = 0;
+	std::uint32_t value = 0;
+	link peer;
+};
+
+TEST_CASE("Validate command buffer", "[command_buffer]") {
+	using table  = cpptables::tbl_sparse_br<NObject, &NObject::index>;
+	using buffer = cpptables::table_command_buffer<table>;
+	constexpr std::uint32_t k_tasks = 8, k_per_task = 100, k_existing = 1000;
+
+	table cont;
+	std::vector<NObject::link> existing;
+	for (std::uint32_t i = 0; i < k_existing; ++i)
+		existing.push_back(cont.emplace(NObject{0, i, NObject::link()}));
+	for (std::uint32_t i = 0; i < k_existing; i += 5)
+		cont.erase(existing[i]);
+	auto range = cont.range();
+
+	std::vector<buffer> buffers;
+	for (std::uint32_t t = 0; t < k_tasks; ++t)
+		buffers.emplace_back(cont, k_per_task);
+	// free slots are handed out before the table grows
+	REQUIRE(cont.range() == range + k_tasks * k_per_task - k_existing / 5);
+	REQUIRE(cont.size() == k_existing - k_existing / 5);
+
+	std::vector<std::vector<NObject::link>> inserted(k_tasks);
+	cpptables::thread_pool pool(3);
+	pool.execute(k_tasks, [&](std::size_t iTask) {
+		auto& buf = buffers[iTask];
+		// the last insert is never made, its slot goes back on apply
+		for (std::uint32_t i = 0; i + 1 < k_per_task; ++i) {
+			NObject obj{0, static_cast<std::uint32_t>(iTask * 1000 + i),
+			            inserted[iTask].empty() ? NObject::link()
+			                                    : inserted[iTask].back()};
+			inserted[iTask].push_back(buf.insert(obj));
+		}
+		for (std::uint32_t i = 1 + 5 * static_cast<std::uint32_t>(iTask);
+		     i < k_existing; i += 5 * k_tasks)
+			buf.erase(existing[i]);
+	});
+	// erase an insert recorded by the previous buffer
+	for (std::uint32_t t = 1; t < k_tasks; ++t)
+		buffers[t].erase(inserted[t - 1].back());
+	REQUIRE(buffers[0].available() == 1);
+	REQUIRE(buffers[1].pending() > k_per_task - 1);
+	REQUIRE(cont.size() == k_existing - k_existing / 5);
+
+	buffer::apply_all(buffers);
+	std::uint32_t erased_existing = 0;
+	for (std::uint32_t i = 1; i < k_existing; i += 5)
+		erased_existing++;
+	REQUIRE(cont.size() == k_existing - k_existing / 5 - erased_existing +
+	                           k_tasks * (k_per_task - 1) - (k_tasks - 1));
+	for (std::uint32_t t = 0; t < k_tasks; ++t) {
+		REQUIRE(buffers[t].pending() == 0);
+		std::size_t live = inserted[t].size() - (t + 1 < k_tasks ? 1 : 0);
+		for (std::size_t i = 0; i < live; ++i) {
+			auto& obj = cont.at(inserted[t][i]);
+			REQUIRE(obj.value == t * 1000 + i);
+			REQUIRE(table::get_link(obj) == inserted[t][i]);
+			if (i)
+				REQUIRE(cont.at(obj.peer).value == obj.value - 1);
+		}
+	}
+	for (std::uint32_t i = 0; i < k_existing; ++i) {
+		if (i % 5 > 1)
+			REQUIRE(cont.at(existing[i]).value == i);
+	}
+
+	// unused and discarded reservations are reused by plain inserts
+	range = cont.range();
+	{
+		buffer discarded(cont, 50);
+		discarded.insert(NObject{0, 0, NObject::link()});
+	}
+	std::uint32_t free = range - cont.size();
+	for (std::uint32_t i = 0; i < free; ++i)
+		cont.emplace(NObject{0, i, NObject::link()});
+	REQUIRE(cont.range() == range);
+}
+
+TEST_CASE("Validate epoch reclamation", "[concurrent]") {
+	using table = cpptables::tbl_sparse_conc_ebr_br<CObject, &CObject::index>;
+	table cont(1 << 16, 8);
+
+	// a pinned reader keeps erased objects alive and their slots unused
+	auto reader = cont.make_reader();
+	REQUIRE(reader);
+	auto first  = cont.emplace("first");
+	CObject* obj = &cont.at(first);
+	{
+		auto guard = reader.pin();
+		REQUIRE(cont.erase(first));
+		REQUIRE(!cont.erase(first));
+		REQUIRE(!cont.try_at(first));
+		REQUIRE(cont.size() == 0);
+		REQUIRE(cont.retired() == 1);
+		for (int i = 0; i < 4; ++i)
+			REQUIRE(cont.reclaim() == 0);
+		REQUIRE(obj->name == "first");
+		auto second = cont.emplace("second");
+		REQUIRE(second != first);
+		REQUIRE(cont.erase(second));
+	}
+	// first was retired at epoch 0 and second at 1, each needs two advances
+	REQUIRE(cont.reclaim() == 1);
+	REQUIRE(cont.retired() == 1);
+	REQUIRE(cont.reclaim() == 1);
+	REQUIRE(cont.retired() == 0);
+	auto range = cont.range();
+	auto third = cont.emplace("third");
+	REQUIRE(cont.range() == range);
+	REQUIRE(cont.erase(third));
+
+	// readers walk the table while a writer churns through it, every object
+	// gets its own name so a reused slot shows up as a changed name
+	constexpr std::uint32_t k_readers = 3, k_rounds = 20000, k_live = 256;
+	auto name = [](std::uint32_t i) { return "live" + std::to_string(i); };
+	std::vector<table::link> links;
+	for (std::uint32_t i = 0; i < k_live; ++i)
+		links.push_back(cont.emplace(name(i)));
+	std::atomic<bool> done{false};
+	std::atomic<std::uint32_t> broken{0}, held{0}, started{0};
+	std::vector<std::thread> readers;
+	for (std::uint32_t r = 0; r < k_readers; ++r) {
+		readers.emplace_back([&, r] {
+			auto own = cont.make_reader();
+			for (std::uint32_t pass = r; !done.load(std::memory_order_acquire);
+			     ++pass) {
+				auto guard = own.pin();
+				if (pass == r)
+					started.fetch_add(1, std::memory_order_release);
+				// an object loaded under the pin stays intact until unpinned
+				CObject const* kept = nullptr;
+				std::string kept_name;
+				for (std::uint32_t i = 0, end = cont.range(); i < end && !kept;
+				     ++i) {
+					kept = cont.try_at(table::link((pass + i) % end));
+					if (kept)
+						kept_name = kept->name;
+				}
+				cont.for_each([&](CObject const& iObj) {
+					if (iObj.name.compare(0, 4, "live"))
+						broken.fetch_add(1, std::memory_order_relaxed);
+				});
+				// stale links too, their slots are never reused under a pin
+				for (std::uint32_t i = 0, end = cont.range(); i < end; ++i) {
+					CObject const* o = cont.try_at(table::link(i));
+					if (o && o->name.compare(0, 4, "live"))
+						broken.fetch_add(1, std::memory_order_relaxed);
+				}
+				if (kept) {
+					held.fetch_add(1, std::memory_order_relaxed);
+					if (kept->name != kept_name)
+						broken.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+		});
+	}
+	// every reader is pinned at least once while the writer churns
+	while (started.load(std::memory_order_acquire) < k_readers)
+		std::this_thread::yield();
+	std::mt19937 rng(7);
+	for (std::uint32_t i = 0; i < k_rounds; ++i) {
+		auto& l = links[rng() % k_live];
+		REQUIRE(cont.erase(l));
+		l = cont.emplace(name(k_live + i));
+	}
+	done.store(true, std::memory_order_release);
+	for (auto& r : readers)
+		r.join();
+	REQUIRE(broken.load() == 0);
+	REQUIRE(held.load() >= k_readers);
+
+	// readers are gone: two advances drain the retired list, after which
+	// every free slot is reused before the table grows
+	cont.reclaim();
+	cont.reclaim();
+	REQUIRE(cont.retired() == 0);
+	REQUIRE(cont.size() == k_live);
+	auto quiet = cont.range();
+	for (std::uint32_t i = cont.size(); i < quiet; ++i)
+		cont.emplace(name(i));
+	REQUIRE(cont.range() == quiet);
+	REQUIRE(cont.size() == quiet);
+}